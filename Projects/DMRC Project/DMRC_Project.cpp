@@ -1,6 +1,5 @@
 #include <iostream>
 #include <fstream>
-#include <conio.h>
 #include <unordered_map>
 #include <unordered_set>
 #include <algorithm>
@@ -8,961 +7,7545 @@
 #include <list>
 #include <limits.h>
 #include <queue>
+#include <limits>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <sstream>
+#include <deque>
+#include <string_view>
+#include <chrono>
+#include <csignal>
+#include <cerrno>
+#include <filesystem>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <conio.h>
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
-int stationIdUsed = -1;
+#ifndef _WIN32
+int getch()
+{
+    termios old, raw;
+    tcgetattr(STDIN_FILENO, &old);
+    raw = old;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    int ch = getchar();
+    tcsetattr(STDIN_FILENO, TCSANOW, &old);
+
+    if(ch == '\n') return 13;
+    if(ch == 127) return 8;
+    return ch;
+}
+#endif
 
-class node
+class MappedFile
 {
 public:
-    char c;
-    unordered_map<char, node*> m;
-    bool t;
+    const char *data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
 
-    node(char ch)
+    MappedFile()
     {
-        c = ch;
-        t = false;
+        data = NULL;
+        size = 0;
+#ifdef _WIN32
+        file = INVALID_HANDLE_VALUE;
+        mapping = NULL;
+#endif
     }
-};
 
-class Stations
-{
-    node* station;
-
-public:
-    Stations()
+    ~MappedFile()
     {
-        station = new node('\0');
+        close();
     }
 
-    void insert(string word)
+    // writable gives a private copy-on-write view: changes stay in memory and never reach the file.
+    bool open(const string &path, bool writable = false)
     {
-        node *temp = station;
-        for(int i = 0; word[i] != '\0'; i++)
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if(file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER length;
+        GetFileSizeEx(file, &length);
+        size = (size_t)length.QuadPart;
+        mapping = size ? CreateFileMappingA(file, NULL, writable ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL) : NULL;
+        data = mapping ? (const char*)MapViewOfFile(mapping, writable ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0) : NULL;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+            return false;
+
+        struct stat st;
+        if(fstat(fd, &st) == 0 && st.st_size > 0)
         {
-            if(temp->m.count(word[i]))
-            {
-                temp = temp->m[word[i]];
-            }
-            else
-            {
-                node * n = new node(word[i]);
-                temp->m[word[i]] = n;
-                temp = n;
-            }
+            size = st.st_size;
+            void *p = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+            data = p == MAP_FAILED ? NULL : (const char*)p;
         }
-        temp->t = true;
+        ::close(fd);
+#endif
+        if(!data)
+        {
+            close();
+            return false;
+        }
+        return true;
     }
 
-    bool find(string word)
+    void close()
     {
-        node *temp = station;
-        for(int i = 0; word[i] != '\0'; i++)
-        {
-            if(temp->m.count(word[i]) == 0)
-            {
-                return false;
-            }
-            else
-            {
-                temp = temp->m[word[i]];
-            }
-        }
-        return temp->t;
-    }
-
-    void setStations()
-    {
-        insert("welcome");
-        insert("seelampur");
-        insert("shastri park");
-        insert("kashmere gate");
-        insert("tis hazari");
-        insert("pulbangash");
-        insert("pratap nagar");
-        insert("shastri nagar");
-        insert("inderlok");
-        insert("kanhaiya nagar");
-        insert("netaji subhash place");
-        insert("rithala");
-        insert("madipur");
-        insert("shivaji park");
-        insert("punjabi bagh");
-        insert("ashok park");
-        insert("sat guru ram singh marg");
-        insert("kirti nagar");
-        insert("shadipur");
-        insert("keshav puram");
-        insert("patel nagar");
-        insert("rajender place");
-        insert("karol bagh");
-        insert("rajiv chowk");
-        insert("barakhamba road");
-        insert("mandi house");
-        insert("pragati maiden");
-        insert("inderprastha");
-        insert("yamuna bank");
-        insert("vishwavidalaya");
-        insert("vidhan sabha");
-        insert("civil lines");
-        insert("chandni chowk");
-        insert("chawri bazar");
-        insert("new delhi");
-        insert("patel chowk");
-        insert("central secretariat");
-        insert("udyog bhawan");
-        insert("lok kalyan marg");
-        insert("jor bagh");
-        insert("lal qila");
-        insert("jama masjid");
-        insert("delhi gate");
-        insert("ito");
-        insert("janptah");
-        insert("khan market");
-        insert("jl nehru stadium");
-        insert("jangpura");
-        insert("rajouri garden");
-        insert("ramesh nagar");
-        insert("moti nagar");
-    }
-
-    void addStation(string word)
-    {
-        insert(word);
+#ifdef _WIN32
+        if(data) UnmapViewOfFile(data);
+        if(mapping) CloseHandle(mapping);
+        if(file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+        mapping = NULL;
+#else
+        if(data) munmap((void*)data, size);
+#endif
+        data = NULL;
+        size = 0;
     }
 };
 
-Stations s;
+int stationIdUsed = -1;
 
-class LineColors
+class BinaryWriter
 {
 public:
-    unordered_map<string, unordered_set<string>> colors;
-
-    LineColors()
-    {
-    }
-
-    void setColors()
-    {
-        colors["welcome"].insert("Red");
-        colors["seelampur"].insert("Red");
-        colors["shastri park"].insert("Red");
-        colors["kashmere gate"].insert("Red");
-        colors["kashmere gate"].insert("Yellow");
-        colors["kashmere gate"].insert("Violet");
-        colors["tis hazari"].insert("Red");
-        colors["pulbangash"].insert("Red");
-        colors["pratap nagar"].insert("Red");
-        colors["shastri nagar"].insert("Red");
-        colors["inderlok"].insert("Green");
-        colors["inderlok"].insert("Red");
-        colors["kanhaiya nagar"].insert("Red");
-        colors["netaji subhash place"].insert("Red");
-        colors["rithala"].insert("Red");
-        colors["madipur"].insert("Green");
-        colors["shivaji park"].insert("Green");
-        colors["punjabi bagh"].insert("Green");
-        colors["ashok park"].insert("Green");
-        colors["sat guru ram singh marg"].insert("Green");
-        colors["kirti nagar"].insert("Green");
-        colors["kirti nagar"].insert("Blue");
-        colors["shadipur"].insert("Blue");
-        colors["keshav puram"].insert("Red");
-        colors["patel nagar"].insert("Blue");
-        colors["rajender place"].insert("Blue");
-        colors["karol bagh"].insert("Blue");
-        colors["rajiv chowk"].insert("Blue");
-        colors["rajiv chowk"].insert("Yellow");
-        colors["barakhamba road"].insert("Blue");
-        colors["mandi house"].insert("Blue");
-        colors["mandi house"].insert("Violet");
-        colors["pragati maiden"].insert("Blue");
-        colors["inderprastha"].insert("Blue");
-        colors["yamuna bank"].insert("Blue");
-        colors["vishwavidalaya"].insert("Yellow");
-        colors["vidhan sabha"].insert("Yellow");
-        colors["civil lines"].insert("Yellow");
-        colors["chandni chowk"].insert("Yellow");
-        colors["chawri bazar"].insert("Yellow");
-        colors["new delhi"].insert("Yellow");
-        colors["patel chowk"].insert("Yellow");
-        colors["central secretariat"].insert("Yellow");
-        colors["central secretariat"].insert("Violet");
-        colors["udyog bhawan"].insert("Yellow");
-        colors["lok kalyan marg"].insert("Yellow");
-        colors["jor bagh"].insert("Yellow");
-        colors["lal qila"].insert("Violet");
-        colors["jama masjid"].insert("Violet");
-        colors["delhi gate"].insert("Violet");
-        colors["ito"].insert("Violet");
-        colors["janptah"].insert("Violet");
-        colors["khan market"].insert("Violet");
-        colors["jl nehru stadium"].insert("Violet");
-        colors["jangpura"].insert("Violet");
-        colors["rajouri garden"].insert("Blue");
-        colors["ramesh nagar"].insert("Blue");
-        colors["moti nagar"].insert("Blue");
-    }
-
-    void addColors(string station, vector<string> &color)
-    {
-        for(auto x : color)
-        {
-            colors[station].insert(x);
-        }
+    ofstream out;
+
+    BinaryWriter(const string &path) : out(path, ios::binary | ios::trunc)
+    {
     }
-};
 
-LineColors c;
+    template<class T>
+    void put(const T *data, size_t count)
+    {
+        static const char zero[8] = {0};
+        size_t bytes = count * sizeof(T);
+        out.write((const char*)data, bytes);
+        out.write(zero, (8 - bytes % 8) % 8);
+    }
+};
 
-class Mapping
+class BinaryReader
 {
 public:
-    vector<string> stationFromId;
-
-    Mapping()
-    {
-        stationFromId.resize(51);
-        stationIdUsed = 50;
-    }
-
-    void setMapping()
-    {
-        stationFromId[0] = "welcome";
-        stationFromId[1] = "seelampur";
-        stationFromId[2] = "shastri park";
-        stationFromId[3] = "kashmere gate";
-        stationFromId[4] = "tis hazari";
-        stationFromId[5] = "pulbangash";
-        stationFromId[6] = "pratap nagar";
-        stationFromId[7] = "shastri nagar";
-        stationFromId[8] = "inderlok";
-        stationFromId[9] = "kanhaiya nagar";
-        stationFromId[10] = "keshav puram";
-        stationFromId[11] = "netaji subhash place";
-        stationFromId[12] = "rithala";
-        stationFromId[13] = "madipur";
-        stationFromId[14] = "shivaji park";
-        stationFromId[15] = "punjabi bagh";
-        stationFromId[16] = "ashok park";
-        stationFromId[17] = "sat guru ram singh marg";
-        stationFromId[18] = "kirti nagar";
-        stationFromId[19] = "shadipur";
-        stationFromId[20] = "patel nagar";
-        stationFromId[21] = "rajender place";
-        stationFromId[22] = "karol bagh";
-        stationFromId[23] = "rajiv chowk";
-        stationFromId[24] = "barakhamba road";
-        stationFromId[25] = "mandi house";
-        stationFromId[26] = "pragati maiden";
-        stationFromId[27] = "inderprastha";
-        stationFromId[28] = "yamuna bank";
-        stationFromId[29] = "vishwavidalaya";
-        stationFromId[30] = "vidhan sabha";
-        stationFromId[31] = "civil lines";
-        stationFromId[32] = "chandni chowk";
-        stationFromId[33] = "chawri bazar";
-        stationFromId[34] = "new delhi";
-        stationFromId[35] = "patel chowk";
-        stationFromId[36] = "central secretariat";
-        stationFromId[37] = "udyog bhawan";
-        stationFromId[38] = "lok kalyan marg";
-        stationFromId[39] = "jor bagh";
-        stationFromId[40] = "lal qila";
-        stationFromId[41] = "jama masjid";
-        stationFromId[42] = "delhi gate";
-        stationFromId[43] = "ito";
-        stationFromId[44] = "janptah";
-        stationFromId[45] = "khan market";
-        stationFromId[46] = "jl nehru stadium";
-        stationFromId[47] = "jangpura";
-        stationFromId[48] = "rajouri garden";
-        stationFromId[49] = "ramesh nagar";
-        stationFromId[50] = "moti nagar";
-    }
+    const char *data;
+    size_t size;
+    size_t at;
+    bool ok;
 
-    void addStationId(string station)
+    BinaryReader(const char *d, size_t n)
     {
-        ++stationIdUsed;
-        stationFromId.push_back(station);
+        data = d;
+        size = n;
+        at = 0;
+        ok = true;
     }
 
-    void displayAll()
+    template<class T>
+    const T *take(size_t count)
     {
-        system("cls");
-        cout << "STATION LIST WITH SERIAL NUMBER" << endl << endl;
-
-        for(int i = 0; i <= stationIdUsed; ++i)
+        if(!ok || count > (size - at) / sizeof(T))
         {
-            cout << i << "    ";
-            if(i < 10) cout << " ";
-            cout << stationFromId[i] << endl;
+            ok = false;
+            return NULL;
         }
-
-        cout << endl << "Press any key to go back... ";
-        getch();
-        system("cls");
+        size_t bytes = count * sizeof(T);
+        const T *p = (const T*)(data + at);
+        at += (bytes + 7) / 8 * 8;
+        at = min(at, size);
+        return p;
     }
 };
 
-Mapping m;
-
-class info
+// Offsets read from a file describe slices of another array: they must start at 0, never decrease and end at its size.
+template<class T>
+bool validOffsets(const T *offset, size_t count, uint64_t total)
 {
-public:
-    string station;
-    int cost;
-    double distance;
-
-    info(string s, int c, double d)
+    if(offset[0] != 0)
+        return false;
+    for(size_t i = 0; i < count; ++i)
     {
-        station = s;
-        cost = c;
-        distance = d;
+        if(offset[i] > offset[i + 1])
+            return false;
     }
-};
+    return (uint64_t)offset[count] == total;
+}
 
-class Lines
+class ThreadPool
 {
-    unordered_map<string, list<info>> line;
-
-public:
-
-    void addLine(string a, string b, int c, double d)
-    {
-        info temp1(a, c, d);
-        info temp2(b, c, d);
-        line[a].push_back(temp2);
-        line[b].push_back(temp1);
-    }
-
-    void setLines()
-    {
-        addLine("rithala", "netaji subhash place", 30, 5.2);
-        addLine("netaji subhash place", "keshav puram", 10, 1.2);
-        addLine("keshav puram", "kanhaiya nagar", 10, 0.8);
-        addLine("kanhaiya nagar", "inderlok", 10, 1.2);
-        addLine("madipur", "shivaji park", 10, 1.1);
-        addLine("shivaji park", "punjabi bagh", 10, 1.6);
-        addLine("punjabi bagh", "ashok park", 10, 0.9);
-        addLine("ashok park", "sat guru ram singh marg", 10, 1.1);
-        addLine("ashok park", "inderlok", 10, 1.4);
-        addLine("rajouri garden", "ramesh nagar", 10, 1);
-        addLine("ramesh nagar", "moti nagar", 10, 1.2);
-        addLine("inderlok", "shastri nagar", 10, 1.2);
-        addLine("moti nagar", "kirti nagar", 10, 1);
-        addLine("sat guru ram singh marg", "kirti nagar", 10, 1);
-        addLine("shastri nagar", "pratap nagar", 10, 1.7);
-        addLine("kirti nagar", "shadipur", 10, 0.7);
-        addLine("pratap nagar", "pulbangash", 10, 0.8);
-        addLine("vishwavidalaya", "vidhan sabha", 10, 1);
-        addLine("shadipur", "patel nagar", 10, 1.3);
-        addLine("pulbangash", "tis hazari", 10, 0.9);
-        addLine("vidhan sabha", "civil lines", 10, 1.3);
-        addLine("patel nagar", "rajender place", 10, 0.9);
-        addLine("tis hazari", "kashmere gate", 10, 1.1);
-        addLine("civil lines", "kashmere gate", 10, 1.1);
-        addLine("rajender place", "karol bagh", 10, 1);
-        addLine("kashmere gate", "shastri park", 20, 2.2);
-        addLine("kashmere gate", "lal qila", 10, 1.5);
-        addLine("kashmere gate", "chandni chowk", 10, 1.1);
-        addLine("shastri park", "seelampur", 10, 1.6);
-        addLine("lal qila", "jama masjid", 10, 0.8);
-        addLine("chandni chowk", "chawri bazar", 10, 1);
-        addLine("seelampur", "welcome", 10, 1.1);
-        addLine("jama masjid", "delhi gate", 10, 1.4);
-        addLine("chawri bazar", "new delhi", 10, 0.8);
-        addLine("karol bagh", "rajiv chowk", 20, 3.4);
-        addLine("new delhi", "rajiv chowk", 10, 1.1);
-        addLine("delhi gate", "ito", 10, 1.3);
-        addLine("rajiv chowk", "barakhamba road", 10, 0.7);
-        addLine("rajiv chowk", "patel chowk", 10, 1.3);
-        addLine("ito", "mandi house", 10, 0.8);
-        addLine("barakhamba road", "mandi house", 10, 1);
-        addLine("mandi house", "pragati maiden", 10, 0.8);
-        addLine("mandi house", "janptah", 10, 1.4);
-        addLine("inderprastha", "pragati maiden", 10, 0.8);
-        addLine("janptah", "central secretariat", 10, 1.3);
-        addLine("patel chowk", "central secretariat", 10, 0.9);
-        addLine("inderprastha", "yamuna bank", 10, 1.8);
-        addLine("central secretariat", "udyog bhawan", 10, 0.3);
-        addLine("central secretariat", "khan market", 20, 2.1);
-        addLine("udyog bhawan", "lok kalyan marg", 10, 1.6);
-        addLine("khan market", "jl nehru stadium", 10, 1.4);
-        addLine("lok kalyan marg", "jor bagh", 10, 1.2);
-        addLine("jl nehru stadium", "jangpura", 10, 0.9);
-    }
+    vector<thread> workers;
+    mutex lock;
+    condition_variable wake;
+    condition_variable done;
+    function<void(int)> job;
+    unsigned generation;
+    int running;
+    bool stopping;
 
-    void displayNetwork()
+public:
+    ThreadPool(int threads = 0)
     {
-        system("cls");
-        cout << "NETWORK CONNECTION OF ALL STATIONS" << endl << endl;
+        if(threads <= 0)
+            threads = max(1u, thread::hardware_concurrency());
 
-        for(auto x : line)
+        generation = 0;
+        running = 0;
+        stopping = false;
+        for(int w = 0; w < threads; ++w)
         {
-            cout << "Station '" << x.first << "' is connected to ->" << endl;
-            for(auto y : x.second)
-            {
-                cout << "     " << y.station << " by cost " << y.cost << " and distance " << y.distance << endl;
-            }
-            cout << endl;
+            workers.push_back(thread([this, w]() { work(w); }));
         }
-
-        cout << endl;
-        cout << "Press any key to go back... ";
-        getch();
-        system("cls");
     }
 
-    void cheapestRoute(string src, string dest)
+    ~ThreadPool()
     {
-        unordered_map<string, int> visitedCost;
-        unordered_map<string, string> parent;
-
-        for(int i = 0; i <= stationIdUsed; ++i)
         {
-            visitedCost[m.stationFromId[i]] = INT_MAX;
-            parent[m.stationFromId[i]] = "none";
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for(auto &t : workers)
+        {
+            t.join();
         }
+    }
 
-        priority_queue<pair<int, string>, vector<pair<int, string>>, greater<pair<int, string>>> pq;
+    int size() const
+    {
+        return workers.size();
+    }
 
-        visitedCost[src] = 0;
-        pq.push({0, src});
+    // Runs body(worker, begin, end) over [0, count) in chunks claimed by the workers and returns once all are done.
+    void parallelFor(size_t count, size_t chunk, function<void(int, size_t, size_t)> body)
+    {
+        atomic<size_t> next(0);
+        unique_lock<mutex> guard(lock);
+        job = [&next, count, chunk, &body](int w)
+        {
+            for(;;)
+            {
+                size_t b = next.fetch_add(chunk);
+                if(b >= count) break;
+                body(w, b, min(count, b + chunk));
+            }
+        };
+        running = workers.size();
+        ++generation;
+        wake.notify_all();
+        done.wait(guard, [this]() { return running == 0; });
+        job = nullptr;
+    }
 
-        while(!pq.empty())
+private:
+    void work(int w)
+    {
+        unsigned seen = 0;
+        for(;;)
         {
-            auto t = pq.top();
-            pq.pop();
+            function<void(int)> task;
+            {
+                unique_lock<mutex> guard(lock);
+                wake.wait(guard, [&]() { return stopping || generation != seen; });
+                if(stopping) return;
+                seen = generation;
+                task = job;
+            }
 
-            int cost = t.first;
-            string stat = t.second;
+            task(w);
 
-            if(stat == dest) break;
+            lock_guard<mutex> guard(lock);
+            if(--running == 0)
+                done.notify_one();
+        }
+    }
+};
 
-            for(auto nbr : line[stat])
-            {
-                string nbrstat = nbr.station;
-                int addc = nbr.cost;
+class TrieNode
+{
+public:
+    int label;
+    int length;
+    int child;
+    int sibling;
+    int id;
 
-                if(visitedCost[nbrstat] > addc + cost)
-                {
-                    visitedCost[nbrstat] = addc + cost;
-                    parent[nbrstat] = stat;
-                    pq.push({visitedCost[nbrstat], nbrstat});
-                }
-            }
-        }
+    TrieNode(int l, int len, int i)
+    {
+        label = l;
+        length = len;
+        child = -1;
+        sibling = -1;
+        id = i;
+    }
+};
+
+class Stations
+{
+public:
+    vector<TrieNode> nodes;
+    string labels;
 
-        string temp = dest;
-        vector<string> journey;
+    Stations()
+    {
+        nodes.push_back(TrieNode(0, 0, -1));
+    }
 
-        while(temp != "none")
+    // Radix trie kept in one node arena; edge labels are slices of a shared character pool.
+    void insert(string_view word, int id)
+    {
+        int v = 0;
+        size_t i = 0;
+        while(i < word.size())
         {
-            journey.push_back(temp);
-            temp = parent[temp];
-        }
+            int prev = -1;
+            int c = nodes[v].child;
+            while(c != -1 && labels[nodes[c].label] < word[i])
+            {
+                prev = c;
+                c = nodes[c].sibling;
+            }
 
-        reverse(journey.begin(), journey.end());
+            if(c == -1 || labels[nodes[c].label] != word[i])
+            {
+                int leaf = nodes.size();
+                nodes.push_back(TrieNode(labels.size(), word.size() - i, id));
+                labels.append(word, i, string::npos);
+                nodes[leaf].sibling = c;
+                if(prev == -1)
+                    nodes[v].child = leaf;
+                else
+                    nodes[prev].sibling = leaf;
+                return;
+            }
 
-        cout << endl << " > Start with ";
-        string startingColor;
-        for(auto x : c.colors[journey[0]])
-        {
-            if(c.colors[journey[1]].find(x) != c.colors[journey[1]].end())
+            int k = 0;
+            while(k < nodes[c].length && i + k < word.size() && labels[nodes[c].label + k] == word[i + k])
             {
-                startingColor = x;
-                break;
+                ++k;
+            }
+
+            if(k < nodes[c].length)
+            {
+                int mid = nodes.size();
+                nodes.push_back(TrieNode(nodes[c].label, k, -1));
+                nodes[mid].child = c;
+                nodes[mid].sibling = nodes[c].sibling;
+                nodes[c].sibling = -1;
+                nodes[c].label += k;
+                nodes[c].length -= k;
+                if(prev == -1)
+                    nodes[v].child = mid;
+                else
+                    nodes[prev].sibling = mid;
+                c = mid;
             }
+            v = c;
+            i += k;
         }
-        cout << startingColor << " colour line" << endl;
-        cout << journey[0];
+        nodes[v].id = id;
+    }
 
-        for(int i = 1; i < journey.size(); ++i)
+    // Returns the node where word ends (possibly inside its edge label), or -1.
+    int walk(string_view word) const
+    {
+        int v = 0;
+        size_t i = 0;
+        while(i < word.size())
         {
-            if(c.colors[journey[i]].find(startingColor) != c.colors[journey[i]].end())
+            int c = nodes[v].child;
+            while(c != -1 && labels[nodes[c].label] != word[i])
             {
-                cout << "->" << journey[i];
+                c = nodes[c].sibling;
             }
-            else
+            if(c == -1)
+                return -1;
+
+            int k = 0;
+            while(k < nodes[c].length && i + k < word.size())
             {
-                for(auto x : c.colors[journey[i-1]])
-                {
-                    if(c.colors[journey[i]].find(x) != c.colors[journey[i-1]].end())
-                    {
-                        startingColor = x;
-                        break;
-                    }
-                }
-                cout << endl << endl << " > Switch to " << startingColor << " color line" << endl;
-                cout << journey[i];
+                if(labels[nodes[c].label + k] != word[i + k])
+                    return -1;
+                ++k;
             }
+            v = c;
+            i += k;
+            if(i == word.size() && k < nodes[c].length)
+                return -(c + 2);
         }
-
-        cout << endl << endl << "*** Total cost of journey will be rupees " << visitedCost[dest] << " ***" << endl << endl << endl;
+        return v;
     }
 
-    void ShortestRoute(string src, string dest)
+    int find(string_view word) const
     {
-        unordered_map<string, double> visitedDist;
-        unordered_map<string, string> parent;
+        int v = walk(word);
+        return v < 0 ? -1 : nodes[v].id;
+    }
 
-        for(int i = 0; i <= stationIdUsed; ++i)
+    void collect(int v, vector<int> &out, int limit) const
+    {
+        if((int)out.size() >= limit) return;
+        if(nodes[v].id >= 0)
+            out.push_back(nodes[v].id);
+        for(int c = nodes[v].child; c != -1; c = nodes[c].sibling)
         {
-            visitedDist[m.stationFromId[i]] = INT_MAX;
-            parent[m.stationFromId[i]] = "none";
+            collect(c, out, limit);
         }
+    }
 
-        priority_queue<pair<double, string>, vector<pair<double, string>>, greater<pair<double, string>>> pq;
-
-        visitedDist[src] = 0;
-        pq.push({0, src});
+    vector<int> complete(string_view prefix, int limit) const
+    {
+        vector<int> out;
+        int v = walk(prefix);
+        if(v < -1)
+            v = -v - 2;
+        if(v >= 0)
+            collect(v, out, limit);
+        return out;
+    }
 
-        while(!pq.empty())
+    void fuzzyFrom(int v, const string &word, int maxEdits, string &path, vector<vector<int>> &rows, vector<pair<int, int>> &out) const
+    {
+        for(int c = nodes[v].child; c != -1; c = nodes[c].sibling)
         {
-            auto t = pq.top();
-            pq.pop();
-
-            double d = t.first;
-            string stat = t.second;
-
-            if(stat == dest) break;
-
-            for(auto nbr : line[stat])
+            size_t depth = path.size();
+            bool alive = true;
+            for(int k = 0; k < nodes[c].length && alive; ++k)
             {
-                string nbrstat = nbr.station;
-                double addd = nbr.distance;
+                char ch = labels[nodes[c].label + k];
+                path.push_back(ch);
+                int i = path.size();
+                if((int)rows.size() <= i)
+                    rows.push_back(vector<int>(word.size() + 1));
+                vector<int> &row = rows[i];
+                const vector<int> &up = rows[i - 1];
 
-                if(visitedDist[nbrstat] > addd + d)
+                row[0] = i;
+                int low = row[0];
+                for(int j = 1; j <= (int)word.size(); ++j)
                 {
-                    visitedDist[nbrstat] = addd + d;
-                    parent[nbrstat] = stat;
-                    pq.push({visitedDist[nbrstat], nbrstat});
+                    row[j] = min(min(up[j] + 1, row[j - 1] + 1), up[j - 1] + (word[j - 1] != ch));
+                    if(i > 1 && j > 1 && word[j - 1] == path[i - 2] && word[j - 2] == ch)
+                        row[j] = min(row[j], rows[i - 2][j - 2] + 1);
+                    low = min(low, row[j]);
                 }
+                alive = low <= maxEdits;
             }
-        }
-
-        string temp = dest;
-        vector<string> journey;
 
-        while(temp != "none")
-        {
-            journey.push_back(temp);
-            temp = parent[temp];
-        }
-        reverse(journey.begin(), journey.end());
-
-        cout << endl << " > Start with ";
-        string startingColor;
-        for(auto x : c.colors[journey[0]])
-        {
-            if(c.colors[journey[1]].find(x) != c.colors[journey[1]].end())
+            if(alive)
             {
-                startingColor = x;
-                break;
+                if(nodes[c].id >= 0 && rows[path.size()][word.size()] <= maxEdits)
+                    out.push_back({rows[path.size()][word.size()], nodes[c].id});
+                fuzzyFrom(c, word, maxEdits, path, rows, out);
             }
+            path.resize(depth);
         }
-        cout << startingColor << " colour line" << endl;
-        cout << journey[0];
+    }
 
-        for(int i = 1; i < journey.size(); ++i)
+    // Stations within maxEdits insertions, deletions, substitutions or adjacent swaps, closest first.
+    vector<pair<int, int>> fuzzy(const string &word, int maxEdits) const
+    {
+        vector<pair<int, int>> out;
+        vector<vector<int>> rows(1, vector<int>(word.size() + 1));
+        for(int j = 0; j <= (int)word.size(); ++j)
         {
-            if(c.colors[journey[i]].find(startingColor) != c.colors[journey[i]].end())
-            {
-                cout << "->" << journey[i];
-            }
-            else
-            {
-                for(auto x : c.colors[journey[i-1]])
-                {
-                    if(c.colors[journey[i]].find(x) != c.colors[journey[i-1]].end())
-                    {
-                        startingColor = x;
-                        break;
-                    }
-                }
-                cout << endl << endl << " > Switch to " << startingColor << " color line" << endl;
-                cout << journey[i];
-            }
+            rows[0][j] = j;
         }
+        string path;
+        fuzzyFrom(0, word, maxEdits, path, rows, out);
+        sort(out.begin(), out.end());
+        return out;
+    }
 
-        cout << endl << endl << "*** Total Distance of journey will be " << visitedDist[dest] << " kms ***" << endl << endl << endl;
+    void addStation(string word, int id)
+    {
+        insert(word, id);
     }
 };
 
-Lines l;
-
-void generatePath(vector<string> &journey) { }
-
-void displayFunctions()
-{
-    cout << "========================================" << endl;
-    cout << "     DELHI METRO NAVIGATION SYSTEM     " << endl;
-    cout << "========================================" << endl << endl;
-    cout << "What would you like to do?" << endl;
-    cout << "1. Display List Of Stations" << endl;
-    cout << "2. See Network of Stations" << endl;
-    cout << "3. Complete Map of MetroLines" << endl;
-    cout << "4. Cheapest way to reach your Destination" << endl;
-    cout << "5. Fastest way to reach your Destination" << endl;
-    cout << "6. Add Stations (Admin Only)" << endl;
-    cout << "0. Exit" << endl << endl;
-}
+Stations s;
 
-void showmap()
+// Lines are interned as small ids and every station keeps a bitmask of its lines, so the lines two stations share
+// are one AND. Lines can be added at any time; existing ids and masks stay valid.
+class LineColors
 {
-    system("cls");
-    cout << "----------------------------------------------------METRO LINES NETWORK-------------------------------------------------" << endl << endl;
-    cout << "Metro system initialized with 51 stations across multiple lines (Red, Yellow, Green, Blue, Violet)" << endl;
-    cout << "Use options 1 and 2 to explore stations and connections" << endl;
-    cout << endl << "------------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << endl << "Press any key to go back...";
-    getch();
-    system("cls");
-}
-
-void cheapest();
-void fastest();
-void addStation();
-void home();
+public:
+    static constexpr int MAX_LINES = 64;
+    vector<string> names;
+    unordered_map<string, int> ids;
+    vector<uint64_t> member;
 
-void cheapest()
-{
-    string src, dest;
-    cin.ignore();
-B:
-    cout << "Enter starting station ('back' to go back): ";
-    string org;
-    getline(cin, src);
-    org = src;
-    bool digit = true;
-    for(int i = 0; i < src.length(); ++i)
+    int lineId(const string &name) const
     {
-        if(src[i] < '0' || src[i] > '9')
-            digit = false;
+        auto it = ids.find(name);
+        return it == ids.end() ? -1 : it->second;
     }
 
-    if(digit)
+    // Returns the line's id, or -1 once all MAX_LINES ids are taken.
+    int addLine(const string &name)
     {
-        if(stoi(src) >= 0 && stoi(src) <= stationIdUsed)
-            src = m.stationFromId[stoi(src)];
+        int id = lineId(name);
+        if(id >= 0 || (int)names.size() == MAX_LINES)
+            return id;
+        names.push_back(name);
+        ids[name] = names.size() - 1;
+        return names.size() - 1;
     }
 
-    for(int i = 0; !digit && i < src.length(); ++i)
+    uint64_t lines(int station) const
     {
-        if(src[i] >= 'A' && src[i] <= 'Z')
-            src[i] += 32;
+        return station < (int)member.size() ? member[station] : 0;
     }
-    if(src == "back")
+
+    static int lowest(uint64_t mask)
     {
-        system("cls");
-        home();
-        return;
+        for(int k = 0; k < MAX_LINES; ++k)
+        {
+            if(mask >> k & 1) return k;
+        }
+        return -1;
     }
-    if(!s.find(src))
+
+    bool addColors(int station, const vector<string> &color)
     {
-        system("cls");
-        cout << "Invalid Starting Location" << endl << endl;
-        goto B;
+        if((int)member.size() <= station)
+            member.resize(station + 1, 0);
+        bool ok = true;
+        for(const string &x : color)
+        {
+            int id = addLine(x);
+            if(id < 0)
+                ok = false;
+            else
+                member[station] |= 1ULL << id;
+        }
+        return ok;
     }
+};
 
-C:
-    cout << "Enter destination station ('back' to go back): ";
-    getline(cin, dest);
+LineColors c;
+
+class Mapping
+{
+public:
+    vector<string_view> stationFromId;
+    deque<string> owned;
+    vector<double> latitude;
+    vector<double> longitude;
 
-    digit = true;
-    for(int i = 0; i < dest.length(); ++i)
+    // station must outlive the mapping; only names held in the mapped network snapshot are added this way.
+    void addMappedStationId(string_view station)
     {
-        if(dest[i] < '0' || dest[i] > '9')
-            digit = false;
+        ++stationIdUsed;
+        stationFromId.push_back(station);
+        latitude.push_back(NAN);
+        longitude.push_back(NAN);
     }
 
-    if(digit)
+    void locate(int id, double lat, double lon)
     {
-        if(stoi(dest) >= 0 && stoi(dest) <= stationIdUsed)
-            dest = m.stationFromId[stoi(dest)];
+        latitude[id] = lat;
+        longitude[id] = lon;
     }
 
-    for(int i = 0; !digit && i < dest.length(); ++i)
+    void addStationId(string station)
     {
-        if(dest[i] >= 'A' && dest[i] <= 'Z')
-            dest[i] += 32;
+        owned.push_back(station);
+        addMappedStationId(string_view(owned.back()));
     }
-    if(dest == "back")
+
+    int getId(const string &station)
     {
-        system("cls");
-        home();
-        return;
+        return s.find(station);
     }
-    if(!s.find(dest))
+
+    void displayAll()
     {
         system("cls");
-        cout << "Invalid Destination Location" << endl << endl;
-        cout << "Enter starting location : " << org << endl;
-        goto C;
+        cout << "STATION LIST WITH SERIAL NUMBER" << endl << endl;
+
+        for(int i = 0; i <= stationIdUsed; ++i)
+        {
+            cout << i << "    ";
+            if(i < 10) cout << " ";
+            cout << stationFromId[i] << endl;
+        }
+
+        cout << endl << "Press any key to go back... ";
+        getch();
+        system("cls");
     }
-    system("cls");
-    l.cheapestRoute(src, dest);
+};
 
-    cout << endl << endl;
-    cout << "Press any key to go back... ";
-    getch();
-    system("cls");
-    home();
-}
+Mapping m;
 
-void fastest()
+int resolveStation(string name, const Stations &trie, int stations)
 {
-    string src, dest;
-    cin.ignore();
-B:
-    cout << "Enter starting station ('back' to go back): ";
-    string org;
-    getline(cin, src);
-    org = src;
-    bool digit = true;
-    for(int i = 0; i < src.length(); ++i)
+    size_t b = name.find_first_not_of(" \t\r");
+    size_t e = name.find_last_not_of(" \t\r");
+    if(b == string::npos)
+        return -1;
+    name = name.substr(b, e - b + 1);
+
+    bool digit = name.size() < 10;
+    for(int i = 0; i < (int)name.size(); ++i)
     {
-        if(src[i] < '0' || src[i] > '9')
+        if(name[i] < '0' || name[i] > '9')
             digit = false;
     }
-
     if(digit)
     {
-        if(stoi(src) >= 0 && stoi(src) <= stationIdUsed)
-            src = m.stationFromId[stoi(src)];
+        int id = stoi(name);
+        return id < stations ? id : -1;
     }
 
-    for(int i = 0; !digit && i < src.length(); ++i)
-    {
-        if(src[i] >= 'A' && src[i] <= 'Z')
-            src[i] += 32;
-    }
-    if(src == "back")
+    for(int i = 0; i < (int)name.size(); ++i)
     {
-        system("cls");
-        home();
-        return;
+        if(name[i] >= 'A' && name[i] <= 'Z')
+            name[i] += 32;
     }
-    if(!s.find(src))
+    return trie.find(name);
+}
+
+int resolveStation(string name)
+{
+    return resolveStation(name, s, stationIdUsed + 1);
+}
+
+class Segment
+{
+public:
+    int a;
+    int b;
+    int cost;
+    double distance;
+
+    Segment(int x, int y, int c, double d)
     {
-        system("cls");
-        cout << "Invalid Starting Location" << endl << endl;
-        goto B;
+        a = x;
+        b = y;
+        cost = c;
+        distance = d;
     }
+};
 
-C:
-    cout << "Enter destination station ('back' to go back): ";
-    getline(cin, dest);
+class Graph
+{
+public:
+    int n;
+    vector<int> offset;
+    vector<int> target;
+    vector<int> cost;
+    vector<double> distance;
 
-    digit = true;
-    for(int i = 0; i < dest.length(); ++i)
+    Graph()
     {
-        if(dest[i] < '0' || dest[i] > '9')
-            digit = false;
+        n = 0;
     }
 
-    if(digit)
+    void build(int stations, const vector<Segment> &segments)
     {
-        if(stoi(dest) >= 0 && stoi(dest) <= stationIdUsed)
-            dest = m.stationFromId[stoi(dest)];
+        n = stations;
+        offset.assign(n + 1, 0);
+
+        for(const Segment &e : segments)
+        {
+            ++offset[e.a + 1];
+            ++offset[e.b + 1];
+        }
+        for(int i = 0; i < n; ++i)
+        {
+            offset[i + 1] += offset[i];
+        }
+
+        int arcs = offset[n];
+        target.resize(arcs);
+        cost.resize(arcs);
+        distance.resize(arcs);
+
+        vector<int> next(offset.begin(), offset.end() - 1);
+        for(const Segment &e : segments)
+        {
+            int x = next[e.a]++;
+            target[x] = e.b;
+            cost[x] = e.cost;
+            distance[x] = e.distance;
+
+            int y = next[e.b]++;
+            target[y] = e.a;
+            cost[y] = e.cost;
+            distance[y] = e.distance;
+        }
     }
 
-    for(int i = 0; !digit && i < dest.length(); ++i)
+    int findArc(int u, int v, bool byCost) const
     {
-        if(dest[i] >= 'A' && dest[i] <= 'Z')
-            dest[i] += 32;
+        int arc = -1;
+        for(int e = offset[u]; e < offset[u + 1]; ++e)
+        {
+            if(target[e] != v) continue;
+            if(arc < 0 || (byCost ? cost[e] < cost[arc] : distance[e] < distance[arc]))
+                arc = e;
+        }
+        return arc;
     }
-    if(dest == "back")
+
+    void measure(const vector<int> &path, bool byCost, int &totalCost, double &totalDistance) const
     {
-        system("cls");
-        home();
-        return;
+        totalCost = 0;
+        totalDistance = 0;
+        for(int i = 1; i < (int)path.size(); ++i)
+        {
+            int e = findArc(path[i - 1], path[i], byCost);
+            totalCost += cost[e];
+            totalDistance += distance[e];
+        }
     }
-    if(!s.find(dest))
+
+    const vector<int> &weights(int) const
     {
-        system("cls");
-        cout << "Invalid Destination Location" << endl << endl;
-        cout << "Enter starting location : " << org << endl;
-        goto C;
+        return cost;
     }
-    system("cls");
-    l.ShortestRoute(src, dest);
 
-    cout << endl << endl;
-    cout << "Press any key to go back... ";
-    getch();
-    system("cls");
-    home();
-}
+    const vector<double> &weights(double) const
+    {
+        return distance;
+    }
+};
 
-void addStation()
+// Binary heap of (key, vertex) pairs; stale entries are skipped by the caller.
+template<class W>
+class BinaryQueue
 {
-    system("cls");
-    string pass;
-    cout << "Enter Password ('back' to go back): ";
-    char ch = 'A';
+public:
+    vector<pair<W, int>> items;
 
-    while(ch != 13)
+    bool empty() const
     {
-        ch = getch();
+        return items.empty();
+    }
 
-        if(isprint(ch))
-        {
-            cout << "*";
-            pass.push_back(ch);
-        }
-        else if(ch == 8 && pass.length())
-        {
-            pass.pop_back();
-            cout << "\b \b";
-        }
+    void clear()
+    {
+        items.clear();
     }
 
-    if(pass == "back")
+    void push(W key, int v)
     {
-        system("cls");
-        home();
-        return;
+        items.push_back({key, v});
+        push_heap(items.begin(), items.end(), greater<pair<W, int>>());
     }
-    else if(pass != "yes")
+
+    pair<W, int> pop()
     {
-        system("cls");
-        cout << "ERROR!!!! INVALID PASSWORD !" << endl << endl;
-        cout << "Press any key to go back and try again... ";
-        getch();
-        addStation();
-        return;
+        pop_heap(items.begin(), items.end(), greater<pair<W, int>>());
+        pair<W, int> x = items.back();
+        items.pop_back();
+        return x;
     }
 
-    system("cls");
-    cout << "***Login Successful***" << endl << endl;
+    W top()
+    {
+        return items.front().first;
+    }
+};
 
-    string name;
-    cout << "Enter station Name: ";
-    cin.ignore();
-    getline(cin, name);
-    s.addStation(name);
-    m.addStationId(name);
+// Radix heap for non-negative integer keys. Bucket b > 0 holds keys whose highest bit differing from the last key
+// popped is bit b - 1, so an entry moves at most 32 times. Keys pushed must not be below the last key popped, which
+// Dijkstra and consistent A* over non-negative weights guarantee.
+class RadixQueue
+{
+public:
+    vector<pair<int, int>> buckets[33];
+    unsigned last;
+    size_t count;
 
-    vector<string> color;
-    string temp;
-    int i = 1;
+    RadixQueue()
+    {
+        last = 0;
+        count = 0;
+    }
 
-    while(i)
+    static int bucket(unsigned key, unsigned from)
     {
-        cout << "Enter color number " << i << " (NULL to stop entering): ";
-        getline(cin, temp);
-        if(temp == "NULL")
-            break;
-        color.push_back(temp);
-        i++;
+        unsigned x = key ^ from;
+        int b = 0;
+        if(x >> 16) { x >>= 16; b += 16; }
+        if(x >> 8) { x >>= 8; b += 8; }
+        if(x >> 4) { x >>= 4; b += 4; }
+        if(x >> 2) { x >>= 2; b += 2; }
+        if(x >> 1) { x >>= 1; b += 1; }
+        return x ? b + 1 : 0;
     }
 
-    c.addColors(name, color);
-    i = 1;
-    int cost;
-    double dist;
-    while(i)
+    bool empty() const
     {
-        cout << "Enter directly connected Station number " << i << " (NULL to stop entering): ";
-        if(i > 1)
-            cin.ignore();
-        getline(cin, temp);
-        if(temp == "NULL")
-            break;
-        cout << "Enter cost of travel: ";
-        cin >> cost;
-        cout << "Enter distance between stations: ";
-        cin >> dist;
-        l.addLine(name, temp, cost, dist);
-        i++;
+        return count == 0;
     }
 
-    cout << endl;
-    cout << "Adding Station";
-    for(int i = 1; i < 6; i++)
+    void clear()
     {
-        for(int j = 0; j < 200000000; j++)
+        for(vector<pair<int, int>> &b : buckets)
         {
+            b.clear();
         }
-        cout << ".";
+        last = 0;
+        count = 0;
     }
-    cout << endl << endl;
 
-    cout << "Station added successfully..." << endl;
-    cout << "Press any key to go back...";
-    getch();
-    system("cls");
-    home();
-}
+    void push(int key, int v)
+    {
+        buckets[bucket(key, last)].push_back({key, v});
+        ++count;
+    }
 
-void home()
-{
-    displayFunctions();
-    cout << "Enter Your Choice: ";
-    int choice;
-A:
-    cin >> choice;
+    // Refills bucket 0 from the lowest non-empty bucket, whose smallest key becomes the new last.
+    void pull()
+    {
+        if(buckets[0].size()) return;
 
-    switch(choice)
+        int i = 1;
+        while(buckets[i].empty()) ++i;
+        unsigned low = UINT_MAX;
+        for(const pair<int, int> &x : buckets[i])
+        {
+            low = min(low, (unsigned)x.first);
+        }
+        last = low;
+        for(const pair<int, int> &x : buckets[i])
+        {
+            buckets[bucket(x.first, last)].push_back(x);
+        }
+        buckets[i].clear();
+    }
+
+    pair<int, int> pop()
     {
-    case 0:
-        break;
-    case 1:
-        m.displayAll();
-        home();
-        break;
+        pull();
+        pair<int, int> x = buckets[0].back();
+        buckets[0].pop_back();
+        --count;
+        return x;
+    }
 
-    case 2:
-        l.displayNetwork();
-        home();
-        break;
+    int top()
+    {
+        pull();
+        return last;
+    }
+};
 
-    case 3:
-        system("cls");
-        showmap();
-        home();
-        break;
+// Integer weights (fares) get the radix heap; distances stay on the binary heap.
+template<class W>
+class QueueFor
+{
+public:
+    typedef BinaryQueue<W> type;
+};
 
-    case 4:
-        system("cls");
-        cheapest();
-        break;
+template<>
+class QueueFor<int>
+{
+public:
+    typedef RadixQueue type;
+};
 
-    case 5:
-        system("cls");
-        fastest();
-        break;
+template<class W>
+class Dijkstra
+{
+public:
+    vector<W> best;
+    vector<int> parent;
+    vector<unsigned> seen;
+    unsigned round;
+    typename QueueFor<W>::type heap;
+    long long settled;
+    long long relaxed;
+    long long pushed;
+    long long stale;
 
-    case 6:
-        system("cls");
-        addStation();
-        break;
+    Dijkstra()
+    {
+        round = 0;
+        settled = 0;
+        relaxed = 0;
+        pushed = 0;
+        stale = 0;
+    }
 
-    default:
-        system("cls");
-        displayFunctions();
-        cout << "Oops!!! Invalid Input.... Enter your choice again: ";
-        goto A;
+    static W infinity()
+    {
+        return numeric_limits<W>::max();
     }
-}
 
-void getReady()
-{
-    s.setStations();
-    m.setMapping();
-    c.setColors();
-    l.setLines();
-}
+    W get(int v) const
+    {
+        return seen[v] == round ? best[v] : infinity();
+    }
 
-int main()
+    bool reached(int v) const
+    {
+        return seen[v] == round;
+    }
+
+    void reset(int n)
+    {
+        if((int)seen.size() != n)
+        {
+            best.assign(n, infinity());
+            parent.assign(n, -1);
+            seen.assign(n, 0);
+            round = 0;
+        }
+        if(++round == 0)
+        {
+            fill(seen.begin(), seen.end(), 0);
+            round = 1;
+        }
+        heap.clear();
+    }
+
+    void label(int v, W d, int p)
+    {
+        label(v, d, p, d);
+    }
+
+    void label(int v, W d, int p, W key)
+    {
+        seen[v] = round;
+        best[v] = d;
+        parent[v] = p;
+        heap.push(key, v);
+        ++pushed;
+    }
+
+    // Settles vertices in order of W from the labelled seeds and returns the first one accepted by stop, or -1.
+    template<class Stop>
+    int settle(const Graph &g, Stop stop)
+    {
+        return settle(g, stop, [](int) { return W(); });
+    }
+
+    // A* order: seeds must be labelled with key d + estimate(v), and estimate must be a consistent lower bound.
+    template<class Stop, class Estimate>
+    int settle(const Graph &g, Stop stop, Estimate estimate)
+    {
+        const vector<W> &weight = g.weights(W());
+        const int *offset = g.offset.data();
+        const int *target = g.target.data();
+
+        while(!heap.empty())
+        {
+            pair<W, int> x = heap.pop();
+            W key = x.first;
+            int u = x.second;
+
+            W d = best[u];
+            if(key > d + estimate(u))
+            {
+                ++stale;
+                continue;
+            }
+            ++settled;
+            if(stop(u)) return u;
+
+            relaxed += offset[u + 1] - offset[u];
+            for(int e = offset[u]; e < offset[u + 1]; ++e)
+            {
+                int v = target[e];
+                W nd = d + weight[e];
+                if(nd < get(v))
+                {
+                    label(v, nd, u, nd + estimate(v));
+                }
+            }
+        }
+        return -1;
+    }
+
+    W top()
+    {
+        return heap.empty() ? infinity() : heap.top();
+    }
+
+    // Settles one vertex and relaxes its arcs; returns it, or -1 once the heap is empty.
+    int step(const Graph &g)
+    {
+        const vector<W> &weight = g.weights(W());
+        while(!heap.empty())
+        {
+            pair<W, int> x = heap.pop();
+            W d = x.first;
+            int u = x.second;
+
+            if(d > best[u])
+            {
+                ++stale;
+                continue;
+            }
+            ++settled;
+            relaxed += g.offset[u + 1] - g.offset[u];
+            for(int e = g.offset[u]; e < g.offset[u + 1]; ++e)
+            {
+                W nd = d + weight[e];
+                if(nd < get(g.target[e]))
+                {
+                    label(g.target[e], nd, u);
+                }
+            }
+            return u;
+        }
+        return -1;
+    }
+
+    // dest < 0 builds the full shortest-path tree from src.
+    bool run(const Graph &g, int src, int dest)
+    {
+        reset(g.n);
+        label(src, 0, -1);
+        settle(g, [dest](int u) { return u == dest; });
+        return dest < 0 ? true : reached(dest);
+    }
+
+    template<class Estimate>
+    bool run(const Graph &g, int src, int dest, Estimate estimate)
+    {
+        reset(g.n);
+        label(src, 0, -1, estimate(src));
+        return settle(g, [dest](int u) { return u == dest; }, estimate) >= 0;
+    }
+
+    vector<int> path(int dest) const
+    {
+        vector<int> journey;
+        if(!reached(dest)) return journey;
+
+        for(int v = dest; v != -1; v = parent[v])
+        {
+            journey.push_back(v);
+        }
+        reverse(journey.begin(), journey.end());
+        return journey;
+    }
+};
+
+// Grows a forward tree from fwd's seeds and a backward one from bwd's seeds over a graph whose arcs come in symmetric
+// pairs, expanding whichever frontier is nearer, until the two frontiers together cannot beat the best meeting found.
+template<class W>
+vector<int> meetInMiddle(const Graph &g, Dijkstra<W> &fwd, Dijkstra<W> &bwd)
+{
+    const vector<W> &weight = g.weights(W());
+    const W INF = Dijkstra<W>::infinity();
+    W best = INF;
+    int meetFwd = -1, meetBwd = -1;
+
+    for(;;)
+    {
+        W tf = fwd.top();
+        W tb = bwd.top();
+        if(tf == INF || tb == INF || (best != INF && tf + tb >= best))
+            break;
+
+        bool forward = tf <= tb;
+        Dijkstra<W> &near = forward ? fwd : bwd;
+        Dijkstra<W> &far = forward ? bwd : fwd;
+        int u = near.step(g);
+        if(u < 0) continue;
+
+        W du = near.get(u);
+        if(far.reached(u) && du + far.get(u) < best)
+        {
+            best = du + far.get(u);
+            meetFwd = meetBwd = u;
+        }
+        for(int e = g.offset[u]; e < g.offset[u + 1]; ++e)
+        {
+            int v = g.target[e];
+            if(far.reached(v) && du + weight[e] + far.get(v) < best)
+            {
+                best = du + weight[e] + far.get(v);
+                meetFwd = forward ? u : v;
+                meetBwd = forward ? v : u;
+            }
+        }
+    }
+
+    vector<int> journey;
+    if(meetFwd < 0) return journey;
+    journey = fwd.path(meetFwd);
+    for(int v = meetFwd == meetBwd ? bwd.parent[meetBwd] : meetBwd; v != -1; v = bwd.parent[v])
+    {
+        journey.push_back(v);
+    }
+    return journey;
+}
+
+// Straight-line lower bound for A*: the chord between two stations times the smallest distance per chord km over all
+// arcs, which keeps the estimate consistent however rough the coordinates are.
+class GeoBound
+{
+public:
+    vector<double> point;
+    double scale;
+    bool usable;
+
+    GeoBound()
+    {
+        scale = 0;
+        usable = false;
+    }
+
+    double chord(int u, int v) const
+    {
+        double dx = point[3 * u] - point[3 * v];
+        double dy = point[3 * u + 1] - point[3 * v + 1];
+        double dz = point[3 * u + 2] - point[3 * v + 2];
+        return sqrt(dx * dx + dy * dy + dz * dz);
+    }
+
+    double estimate(int u, int t) const
+    {
+        return scale * chord(u, t);
+    }
+
+    // Unusable unless every station has coordinates.
+    void build(const Graph &g)
+    {
+        const double EARTH = 6371.0;
+        const double RADIANS = 3.14159265358979323846 / 180;
+        usable = false;
+        point.assign(3 * g.n, 0);
+        for(int v = 0; v < g.n; ++v)
+        {
+            double lat = m.latitude[v] * RADIANS;
+            double lon = m.longitude[v] * RADIANS;
+            if(std::isnan(lat) || std::isnan(lon))
+                return;
+            point[3 * v] = EARTH * cos(lat) * cos(lon);
+            point[3 * v + 1] = EARTH * cos(lat) * sin(lon);
+            point[3 * v + 2] = EARTH * sin(lat);
+        }
+
+        scale = numeric_limits<double>::infinity();
+        for(int u = 0; u < g.n; ++u)
+        {
+            for(int e = g.offset[u]; e < g.offset[u + 1]; ++e)
+            {
+                double c = chord(u, g.target[e]);
+                if(c > 0)
+                    scale = min(scale, g.distance[e] / c);
+            }
+        }
+        scale = isinf(scale) ? 0 : scale * (1 - 1e-9);
+        usable = true;
+    }
+};
+
+class RouteTable
+{
+public:
+    static const uint32_t VERSION = 1;
+
+    class Header
+    {
+    public:
+        char magic[8];
+        uint32_t version;
+        uint32_t stations;
+        uint64_t fingerprint;
+    };
+
+    MappedFile file;
+    int n;
+    uint64_t fingerprint;
+    double *dist;
+    int *cost;
+    int *nextByCost;
+    int *nextByDist;
+    vector<double> ownDist;
+    vector<int> ownInts;
+
+    RouteTable()
+    {
+        n = 0;
+        fingerprint = 0;
+    }
+
+    // File layout: Header, then n*n distances, costs, next hops by cost and next hops by distance, row = source.
+    static bool build(const Graph &g, uint64_t fp, const string &path)
+    {
+        size_t n = g.n;
+        vector<double> d(n * n);
+        vector<int> cst(n * n), nc(n * n), nd(n * n);
+        Dijkstra<int> bycost;
+        Dijkstra<double> bydist;
+
+        for(size_t t = 0; t < n; ++t)
+        {
+            bycost.run(g, t, -1);
+            bydist.run(g, t, -1);
+
+            for(size_t s = 0; s < n; ++s)
+            {
+                cst[s * n + t] = bycost.get(s);
+                nc[s * n + t] = s == t ? t : bycost.reached(s) ? bycost.parent[s] : -1;
+                d[s * n + t] = bydist.get(s);
+                nd[s * n + t] = s == t ? t : bydist.reached(s) ? bydist.parent[s] : -1;
+            }
+        }
+
+        Header h;
+        memcpy(h.magic, "DMRCRT\0\0", 8);
+        h.version = VERSION;
+        h.stations = n;
+        h.fingerprint = fp;
+
+        ofstream out(path, ios::binary | ios::trunc);
+        out.write((const char*)&h, sizeof(h));
+        out.write((const char*)d.data(), d.size() * sizeof(double));
+        out.write((const char*)cst.data(), cst.size() * sizeof(int));
+        out.write((const char*)nc.data(), nc.size() * sizeof(int));
+        out.write((const char*)nd.data(), nd.size() * sizeof(int));
+        return (bool)out;
+    }
+
+    bool load(const string &path)
+    {
+        n = 0;
+        if(!file.open(path, true) || file.size < sizeof(Header))
+            return false;
+
+        const Header *h = (const Header*)file.data;
+        const size_t CELL = sizeof(double) + 3 * sizeof(int);
+        size_t room = (file.size - sizeof(Header)) / CELL;
+        if(memcmp(h->magic, "DMRCRT\0\0", 8) != 0 || h->version != VERSION || h->stations >= INT_MAX ||
+           (h->stations > 0 && room / h->stations < h->stations) ||
+           file.size != sizeof(Header) + (size_t)h->stations * h->stations * CELL)
+        {
+            file.close();
+            return false;
+        }
+
+        size_t cells = (size_t)h->stations * h->stations;
+        dist = (double*)(file.data + sizeof(Header));
+        cost = (int*)(dist + cells);
+        nextByCost = cost + cells;
+        nextByDist = nextByCost + cells;
+        // The hops by distance follow those by cost, so one pass checks both.
+        for(size_t i = 0; i < 2 * cells; ++i)
+        {
+            if(nextByCost[i] < -1 || nextByCost[i] >= (int)h->stations)
+            {
+                file.close();
+                return false;
+            }
+        }
+
+        n = h->stations;
+        fingerprint = h->fingerprint;
+        return true;
+    }
+
+    bool matches(int stations, uint64_t fp) const
+    {
+        return n > 0 && n == stations && fingerprint == fp;
+    }
+
+    // New stations start unreachable; the matrices move into memory owned by the table.
+    void grow(int stations)
+    {
+        if(stations <= n) return;
+
+        size_t cells = (size_t)stations * stations;
+        vector<double> d(cells, numeric_limits<double>::max());
+        vector<int> ints(3 * cells);
+        int *c = ints.data();
+        int *nc = c + cells;
+        int *nd = nc + cells;
+        fill(c, nc, INT_MAX);
+        fill(nc, nc + 2 * cells, -1);
+
+        for(int s = 0; s < stations; ++s)
+        {
+            if(s < n)
+            {
+                copy(dist + (size_t)s * n, dist + (size_t)s * n + n, d.begin() + (size_t)s * stations);
+                copy(cost + (size_t)s * n, cost + (size_t)s * n + n, c + (size_t)s * stations);
+                copy(nextByCost + (size_t)s * n, nextByCost + (size_t)s * n + n, nc + (size_t)s * stations);
+                copy(nextByDist + (size_t)s * n, nextByDist + (size_t)s * n + n, nd + (size_t)s * stations);
+                continue;
+            }
+            d[(size_t)s * stations + s] = 0;
+            c[(size_t)s * stations + s] = 0;
+            nc[(size_t)s * stations + s] = s;
+            nd[(size_t)s * stations + s] = s;
+        }
+
+        ownDist.swap(d);
+        ownInts.swap(ints);
+        file.close();
+        n = stations;
+        dist = ownDist.data();
+        cost = ownInts.data();
+        nextByCost = cost + cells;
+        nextByDist = nextByCost + cells;
+    }
+
+    // Only pairs s, t with d(s,x) + w + d(y,t) < d(s,t) change; sources and targets for each direction are found from the old rows of x and y.
+    template<class W>
+    void relax(W *D, int *next, int x, int y, W w)
+    {
+        const W INF = is_same<W, int>::value ? (W)INT_MAX : numeric_limits<W>::max();
+        if(D[(size_t)x * n + y] <= w) return;
+
+        vector<W> rowX(D + (size_t)x * n, D + (size_t)x * n + n);
+        vector<W> rowY(D + (size_t)y * n, D + (size_t)y * n + n);
+        for(int pass = 0; pass < 2; ++pass)
+        {
+            const vector<W> &near = pass ? rowY : rowX;
+            const vector<W> &far = pass ? rowX : rowY;
+            int a = pass ? y : x;
+            int b = pass ? x : y;
+
+            vector<int> sources, targets;
+            for(int v = 0; v < n; ++v)
+            {
+                if(near[v] != INF && (far[v] == INF || near[v] + w < far[v]))
+                    sources.push_back(v);
+                if(far[v] != INF && (near[v] == INF || far[v] + w < near[v]))
+                    targets.push_back(v);
+            }
+
+            for(int src : sources)
+            {
+                W *row = D + (size_t)src * n;
+                int *hop = next + (size_t)src * n;
+                int first = src == a ? b : hop[a];
+                for(int t : targets)
+                {
+                    W via = near[src] + w + far[t];
+                    if(row[t] == INF || via < row[t])
+                    {
+                        row[t] = via;
+                        hop[t] = first;
+                    }
+                }
+            }
+        }
+    }
+
+    void insertEdge(int x, int y, int c, double d)
+    {
+        relax<int>(cost, nextByCost, x, y, c);
+        relax<double>(dist, nextByDist, x, y, d);
+    }
+
+    // A route longer than n stations means the hops loop, so the table is wrong and the walk gives up.
+    vector<int> walk(const int *next, int s, int t) const
+    {
+        vector<int> journey;
+        if(next[(size_t)s * n + t] < 0) return journey;
+
+        journey.push_back(s);
+        while(s != t)
+        {
+            s = next[(size_t)s * n + t];
+            if(s < 0 || (int)journey.size() >= n)
+                return vector<int>();
+            journey.push_back(s);
+        }
+        return journey;
+    }
+};
+
+template<class W>
+class HubEntry
+{
+public:
+    int32_t hub;
+    int32_t parent;
+    W weight;
+};
+
+// One criterion of a 2-hop labelling: each station's entries are sorted by hub rank, and every shortest path passes
+// through a hub that both ends carry. parent is the next station towards the hub, so a path unfolds hub by hub.
+template<class W>
+class HubIndex
+{
+public:
+    const uint64_t *offset;
+    const HubEntry<W> *entries;
+    const int32_t *order;
+    int n;
+
+    HubIndex()
+    {
+        n = 0;
+    }
+
+    static W infinity()
+    {
+        return numeric_limits<W>::max();
+    }
+
+    // Merges the two label lists; via gets the best common hub's rank, or -1.
+    W query(int s, int t, int &via) const
+    {
+        const HubEntry<W> *a = entries + offset[s], *ae = entries + offset[s + 1];
+        const HubEntry<W> *b = entries + offset[t], *be = entries + offset[t + 1];
+        W best = infinity();
+        via = -1;
+        while(a < ae && b < be)
+        {
+            if(a->hub < b->hub)
+                ++a;
+            else if(b->hub < a->hub)
+                ++b;
+            else
+            {
+                if(a->weight + b->weight < best)
+                {
+                    best = a->weight + b->weight;
+                    via = a->hub;
+                }
+                ++a;
+                ++b;
+            }
+        }
+        return best;
+    }
+
+    // The order must be a permutation, each label must be sorted by hub, and every hub and parent must be a station
+    // of an n-station network.
+    bool valid(int n, uint64_t count) const
+    {
+        if(!validOffsets(offset, n, count))
+            return false;
+        vector<bool> seen(n, false);
+        for(int v = 0; v < n; ++v)
+        {
+            if(order[v] < 0 || order[v] >= n || seen[order[v]])
+                return false;
+            seen[order[v]] = true;
+            for(uint64_t i = offset[v]; i < offset[v + 1]; ++i)
+            {
+                const HubEntry<W> &x = entries[i];
+                if(x.hub < 0 || x.hub >= n || x.parent < -1 || x.parent >= n || (i > offset[v] && entries[i - 1].hub >= x.hub))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    int towards(int v, int hub) const
+    {
+        const HubEntry<W> *b = entries + offset[v], *e = entries + offset[v + 1];
+        const HubEntry<W> *x = lower_bound(b, e, hub, [](const HubEntry<W> &y, int h) { return y.hub < h; });
+        return x < e && x->hub == hub ? x->parent : -1;
+    }
+
+    vector<int> path(int s, int t) const
+    {
+        int via;
+        vector<int> journey, back;
+        query(s, t, via);
+        if(via < 0) return journey;
+
+        // A walk longer than n stations means the parents loop; give up rather than follow them forever.
+        int h = order[via];
+        for(int v = s; v != h; v = towards(v, via))
+        {
+            if(v < 0 || (int)journey.size() >= n) return vector<int>();
+            journey.push_back(v);
+        }
+        for(int v = t; v != h; v = towards(v, via))
+        {
+            if(v < 0 || (int)back.size() >= n) return vector<int>();
+            back.push_back(v);
+        }
+        journey.push_back(h);
+        journey.insert(journey.end(), back.rbegin(), back.rend());
+        return journey;
+    }
+
+    // Pruned landmark labelling: a search from each hub in rank order stops expanding wherever the labels so far
+    // already give a distance no longer than its own.
+    static void build(const Graph &g, const vector<int> &order, vector<uint64_t> &offset, vector<HubEntry<W>> &flat)
+    {
+        const W INF = infinity();
+        const vector<W> &weight = g.weights(W());
+        vector<vector<HubEntry<W>>> labels(g.n);
+        vector<W> root(g.n, INF);
+        Dijkstra<W> search;
+
+        for(int r = 0; r < g.n; ++r)
+        {
+            int h = order[r];
+            for(const HubEntry<W> &x : labels[h])
+            {
+                root[x.hub] = x.weight;
+            }
+
+            search.reset(g.n);
+            search.label(h, 0, -1);
+            while(!search.heap.empty())
+            {
+                pair<W, int> x = search.heap.pop();
+                W d = x.first;
+                int u = x.second;
+                if(d > search.best[u]) continue;
+
+                bool covered = false;
+                for(const HubEntry<W> &y : labels[u])
+                {
+                    if(root[y.hub] != INF && root[y.hub] + y.weight <= d + (W)1e-9)
+                    {
+                        covered = true;
+                        break;
+                    }
+                }
+                if(covered) continue;
+
+                labels[u].push_back({r, search.parent[u], d});
+                for(int e = g.offset[u]; e < g.offset[u + 1]; ++e)
+                {
+                    W nd = d + weight[e];
+                    if(nd < search.get(g.target[e]))
+                        search.label(g.target[e], nd, u);
+                }
+            }
+
+            for(const HubEntry<W> &x : labels[h])
+            {
+                root[x.hub] = INF;
+            }
+        }
+
+        offset.assign(1, 0);
+        flat.clear();
+        for(int v = 0; v < g.n; ++v)
+        {
+            flat.insert(flat.end(), labels[v].begin(), labels[v].end());
+            offset.push_back(flat.size());
+            vector<HubEntry<W>>().swap(labels[v]);
+        }
+    }
+};
+
+// Hub labels for both criteria, for networks too big for an all-pairs table. Hubs are ranked by degree, so
+// interchanges come first.
+class HubLabels
+{
+public:
+    static const uint32_t VERSION = 1;
+
+    class Header
+    {
+    public:
+        char magic[8];
+        uint32_t version;
+        uint32_t stations;
+        uint64_t fingerprint;
+        uint64_t costEntries;
+        uint64_t distEntries;
+    };
+
+    MappedFile file;
+    int n;
+    uint64_t fingerprint;
+    HubIndex<int> cost;
+    HubIndex<double> dist;
+
+    HubLabels()
+    {
+        n = 0;
+        fingerprint = 0;
+    }
+
+    // File layout: Header, hub order, then offsets and entries by cost, then offsets and entries by distance.
+    static bool build(const Graph &g, uint64_t fp, const string &path)
+    {
+        vector<int> order(g.n);
+        for(int v = 0; v < g.n; ++v)
+        {
+            order[v] = v;
+        }
+        stable_sort(order.begin(), order.end(), [&g](int a, int b)
+        {
+            return g.offset[a + 1] - g.offset[a] > g.offset[b + 1] - g.offset[b];
+        });
+
+        vector<uint64_t> costOffset, distOffset;
+        vector<HubEntry<int>> costEntries;
+        vector<HubEntry<double>> distEntries;
+        HubIndex<int>::build(g, order, costOffset, costEntries);
+        HubIndex<double>::build(g, order, distOffset, distEntries);
+
+        Header h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, "DMRCHUB\0", 8);
+        h.version = VERSION;
+        h.stations = g.n;
+        h.fingerprint = fp;
+        h.costEntries = costEntries.size();
+        h.distEntries = distEntries.size();
+
+        BinaryWriter w(path);
+        w.put(&h, 1);
+        w.put(order.data(), order.size());
+        w.put(costOffset.data(), costOffset.size());
+        w.put(costEntries.data(), costEntries.size());
+        w.put(distOffset.data(), distOffset.size());
+        w.put(distEntries.data(), distEntries.size());
+        return (bool)w.out;
+    }
+
+    bool load(const string &path)
+    {
+        n = 0;
+        if(!file.open(path))
+            return false;
+
+        BinaryReader r(file.data, file.size);
+        const Header *h = r.take<Header>(1);
+        if(!h || memcmp(h->magic, "DMRCHUB\0", 8) != 0 || h->version != VERSION || h->stations >= INT_MAX)
+        {
+            file.close();
+            return false;
+        }
+        cost.order = dist.order = r.take<int32_t>(h->stations);
+        cost.offset = r.take<uint64_t>((size_t)h->stations + 1);
+        cost.entries = r.take<HubEntry<int>>(h->costEntries);
+        dist.offset = r.take<uint64_t>((size_t)h->stations + 1);
+        dist.entries = r.take<HubEntry<double>>(h->distEntries);
+        if(!r.ok || !cost.valid(h->stations, h->costEntries) || !dist.valid(h->stations, h->distEntries))
+        {
+            file.close();
+            return false;
+        }
+
+        n = cost.n = dist.n = h->stations;
+        fingerprint = h->fingerprint;
+        return true;
+    }
+
+    bool matches(int stations, uint64_t fp) const
+    {
+        return n > 0 && n == stations && fingerprint == fp;
+    }
+};
+
+// Customisable contraction hierarchy. The station order and the upward arcs depend only on which stations are joined,
+// so fare or distance changes only re-customise the arc weights; any network whose segments are all upward arcs can
+// reuse a saved order.
+class Hierarchy
+{
+public:
+    static const uint32_t VERSION = 1;
+
+    class Header
+    {
+    public:
+        char magic[8];
+        uint32_t version;
+        uint32_t stations;
+        uint64_t arcs;
+    };
+
+    int n;
+    vector<int> rank;
+    vector<int> offset;
+    vector<int> target;
+    Graph up;
+    vector<int> costVia;
+    vector<int> distVia;
+    bool customised;
+
+    Hierarchy()
+    {
+        n = 0;
+        customised = false;
+    }
+
+    // Minimum-degree elimination: the station with fewest remaining neighbours goes next, and its remaining
+    // neighbours, all ranked above it, become its upward arcs and are joined to each other.
+    void build(const Graph &g)
+    {
+        n = g.n;
+        vector<vector<int>> adj(n), upward(n);
+        for(int u = 0; u < n; ++u)
+        {
+            for(int e = g.offset[u]; e < g.offset[u + 1]; ++e)
+            {
+                if(g.target[e] != u)
+                    adj[u].push_back(g.target[e]);
+            }
+            sort(adj[u].begin(), adj[u].end());
+            adj[u].erase(unique(adj[u].begin(), adj[u].end()), adj[u].end());
+        }
+
+        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> next;
+        for(int u = 0; u < n; ++u)
+        {
+            next.push({(int)adj[u].size(), u});
+        }
+
+        rank.assign(n, -1);
+        vector<int> merged;
+        for(int r = 0; r < n;)
+        {
+            pair<int, int> x = next.top();
+            next.pop();
+            int v = x.second;
+            if(rank[v] >= 0 || x.first != (int)adj[v].size()) continue;
+
+            rank[v] = r++;
+            for(int u : adj[v])
+            {
+                merged.clear();
+                set_union(adj[u].begin(), adj[u].end(), adj[v].begin(), adj[v].end(), back_inserter(merged));
+                merged.erase(remove_if(merged.begin(), merged.end(), [u, v](int w) { return w == u || w == v; }), merged.end());
+                adj[u].swap(merged);
+                next.push({(int)adj[u].size(), u});
+            }
+            upward[v].swap(adj[v]);
+        }
+
+        offset.assign(1, 0);
+        target.clear();
+        for(int v = 0; v < n; ++v)
+        {
+            target.insert(target.end(), upward[v].begin(), upward[v].end());
+            offset.push_back(target.size());
+        }
+        customised = false;
+    }
+
+    // Upward arc between a and b in the full arc list, or -1.
+    int find(int a, int b) const
+    {
+        if(rank[a] > rank[b]) swap(a, b);
+        const int *x = lower_bound(target.data() + offset[a], target.data() + offset[a + 1], b);
+        return x < target.data() + offset[a + 1] && *x == b ? x - target.data() : -1;
+    }
+
+    // Same, among the arcs kept in up.
+    int arc(int a, int b) const
+    {
+        if(rank[a] > rank[b]) swap(a, b);
+        const int *x = lower_bound(up.target.data() + up.offset[a], up.target.data() + up.offset[a + 1], b);
+        return x < up.target.data() + up.offset[a + 1] && *x == b ? x - up.target.data() : -1;
+    }
+
+    // Lower triangles, lowest station first: an arc x-y can shortcut through any station below both that reaches each.
+    // Arcs no path backs are left out of up. Returns false if a segment has no upward arc or a triangle
+    // misses its closing arc, as in a hierarchy file built for another network.
+    bool customise(const Graph &g)
+    {
+        customised = false;
+        if(n != g.n)
+            return false;
+
+        const int INF_COST = Dijkstra<int>::infinity();
+        const double INF_DIST = Dijkstra<double>::infinity();
+        vector<int> cost(target.size(), INF_COST), costMid(target.size(), -1);
+        vector<double> dist(target.size(), INF_DIST);
+        vector<int> distMid(target.size(), -1);
+        for(int u = 0; u < n; ++u)
+        {
+            for(int e = g.offset[u]; e < g.offset[u + 1]; ++e)
+            {
+                int v = g.target[e];
+                if(rank[u] > rank[v] || u == v) continue;
+                int a = find(u, v);
+                if(a < 0)
+                    return false;
+                cost[a] = min(cost[a], g.cost[e]);
+                dist[a] = min(dist[a], g.distance[e]);
+            }
+        }
+
+        vector<int> order(n);
+        for(int v = 0; v < n; ++v)
+        {
+            order[rank[v]] = v;
+        }
+        for(int v : order)
+        {
+            for(int i = offset[v]; i < offset[v + 1]; ++i)
+            {
+                for(int j = i + 1; j < offset[v + 1]; ++j)
+                {
+                    int a = find(target[i], target[j]);
+                    if(a < 0)
+                        return false;
+                    if(cost[i] != INF_COST && cost[j] != INF_COST && cost[i] + cost[j] < cost[a])
+                    {
+                        cost[a] = cost[i] + cost[j];
+                        costMid[a] = v;
+                    }
+                    if(dist[i] != INF_DIST && dist[j] != INF_DIST && dist[i] + dist[j] < dist[a])
+                    {
+                        dist[a] = dist[i] + dist[j];
+                        distMid[a] = v;
+                    }
+                }
+            }
+        }
+
+        up.n = n;
+        up.offset.assign(1, 0);
+        up.target.clear();
+        up.cost.clear();
+        up.distance.clear();
+        costVia.clear();
+        distVia.clear();
+        for(int v = 0; v < n; ++v)
+        {
+            for(int a = offset[v]; a < offset[v + 1]; ++a)
+            {
+                if(cost[a] == INF_COST) continue;
+                up.target.push_back(target[a]);
+                up.cost.push_back(cost[a]);
+                up.distance.push_back(dist[a]);
+                costVia.push_back(costMid[a]);
+                distVia.push_back(distMid[a]);
+            }
+            up.offset.push_back(up.target.size());
+        }
+        customised = true;
+        return true;
+    }
+
+    // Upward searches from both ends; every shortest route climbs to its highest station and descends, so once neither
+    // frontier is below the best meeting found it is final. The shortcuts are then unpacked back into stations.
+    template<class W>
+    vector<int> route(Dijkstra<W> &fwd, Dijkstra<W> &bwd, int from, int to, const vector<int> &via) const
+    {
+        const W INF = Dijkstra<W>::infinity();
+        W best = INF;
+        int meet = -1;
+        fwd.reset(n);
+        bwd.reset(n);
+        fwd.label(from, 0, -1);
+        bwd.label(to, 0, -1);
+        for(;;)
+        {
+            W tf = fwd.top();
+            W tb = bwd.top();
+            if(min(tf, tb) == INF || min(tf, tb) >= best)
+                break;
+
+            Dijkstra<W> &near = tf <= tb ? fwd : bwd;
+            Dijkstra<W> &far = tf <= tb ? bwd : fwd;
+            int u = near.step(up);
+            if(u >= 0 && far.reached(u) && near.get(u) + far.get(u) < best)
+            {
+                best = near.get(u) + far.get(u);
+                meet = u;
+            }
+        }
+
+        vector<int> journey;
+        if(meet < 0) return journey;
+
+        vector<int> climb = fwd.path(meet);
+        for(int v = bwd.parent[meet]; v != -1; v = bwd.parent[v])
+        {
+            climb.push_back(v);
+        }
+
+        journey.push_back(from);
+        vector<pair<int, int>> todo;
+        for(int i = 1; i < (int)climb.size(); ++i)
+        {
+            todo.push_back({climb[i - 1], climb[i]});
+            while(todo.size())
+            {
+                pair<int, int> x = todo.back();
+                todo.pop_back();
+                int mid = via[arc(x.first, x.second)];
+                if(mid < 0)
+                    journey.push_back(x.second);
+                else
+                {
+                    todo.push_back({mid, x.second});
+                    todo.push_back({x.first, mid});
+                }
+            }
+        }
+        return journey;
+    }
+
+    bool save(const string &path) const
+    {
+        Header h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, "DMRCCCH\0", 8);
+        h.version = VERSION;
+        h.stations = n;
+        h.arcs = target.size();
+
+        BinaryWriter w(path);
+        w.put(&h, 1);
+        w.put(rank.data(), rank.size());
+        w.put(offset.data(), offset.size());
+        w.put(target.data(), target.size());
+        return (bool)w.out;
+    }
+
+    bool load(const string &path)
+    {
+        MappedFile file;
+        if(!file.open(path))
+            return false;
+
+        BinaryReader r(file.data, file.size);
+        const Header *h = r.take<Header>(1);
+        if(!h || memcmp(h->magic, "DMRCCCH\0", 8) != 0 || h->version != VERSION || h->stations >= INT_MAX || h->arcs >= INT_MAX)
+            return false;
+        const int32_t *ranks = r.take<int32_t>(h->stations);
+        const int32_t *offsets = r.take<int32_t>((size_t)h->stations + 1);
+        const int32_t *targets = r.take<int32_t>(h->arcs);
+        if(!r.ok || !validOffsets(offsets, h->stations, h->arcs))
+            return false;
+
+        // Ranks must be a permutation, and each station's arcs sorted and leading to stations ranked above it.
+        vector<char> ranked(h->stations, 0);
+        for(uint32_t v = 0; v < h->stations; ++v)
+        {
+            if(ranks[v] < 0 || ranks[v] >= (int)h->stations || ranked[ranks[v]])
+                return false;
+            ranked[ranks[v]] = 1;
+        }
+        for(uint32_t v = 0; v < h->stations; ++v)
+        {
+            for(int e = offsets[v]; e < offsets[v + 1]; ++e)
+            {
+                int t = targets[e];
+                if(t < 0 || t >= (int)h->stations || ranks[t] <= ranks[v] || (e > offsets[v] && targets[e - 1] >= t))
+                    return false;
+            }
+        }
+
+        n = h->stations;
+        rank.assign(ranks, ranks + n);
+        offset.assign(offsets, offsets + n + 1);
+        target.assign(targets, targets + h->arcs);
+        customised = false;
+        return true;
+    }
+};
+
+class LineGraph
+{
+public:
+    Graph g;
+    vector<int> first;
+    vector<int> station;
+    vector<int> line;
+    vector<string> lineNames;
+    vector<uint64_t> lines;
+    int transferCost;
+    double transferDistance;
+
+    // One vertex per (station, line); riding a segment keeps the line, changing line at a station costs the penalty.
+    void build(int n, const vector<Segment> &segments, int penaltyCost, double penaltyDistance)
+    {
+        transferCost = penaltyCost;
+        transferDistance = penaltyDistance;
+        lineNames = c.names;
+
+        first.assign(n + 1, 0);
+        lines.assign(n, 0);
+        station.clear();
+        line.clear();
+        for(int i = 0; i < n; ++i)
+        {
+            first[i] = station.size();
+            lines[i] = c.lines(i);
+            for(int k = 0; k < (int)lineNames.size(); ++k)
+            {
+                if(lines[i] >> k & 1)
+                {
+                    station.push_back(i);
+                    line.push_back(k);
+                }
+            }
+            if((int)station.size() == first[i])
+            {
+                station.push_back(i);
+                line.push_back(-1);
+            }
+        }
+        first[n] = station.size();
+
+        vector<Segment> arcs;
+        for(const Segment &e : segments)
+        {
+            bool common = false;
+            for(int x = first[e.a]; x < first[e.a + 1]; ++x)
+            {
+                for(int y = first[e.b]; y < first[e.b + 1]; ++y)
+                {
+                    if(line[x] == line[y] && line[x] >= 0)
+                    {
+                        arcs.push_back(Segment(x, y, e.cost, e.distance));
+                        common = true;
+                    }
+                }
+            }
+            for(int x = first[e.a]; !common && x < first[e.a + 1]; ++x)
+            {
+                for(int y = first[e.b]; y < first[e.b + 1]; ++y)
+                {
+                    arcs.push_back(Segment(x, y, e.cost, e.distance));
+                }
+            }
+        }
+        for(int i = 0; i < n; ++i)
+        {
+            for(int x = first[i]; x < first[i + 1]; ++x)
+            {
+                for(int y = x + 1; y < first[i + 1]; ++y)
+                {
+                    arcs.push_back(Segment(x, y, transferCost, transferDistance));
+                }
+            }
+        }
+
+        g.build(station.size(), arcs);
+    }
+
+    template<class W>
+    vector<int> route(Dijkstra<W> &search, int from, int to) const
+    {
+        search.reset(g.n);
+        for(int x = first[from]; x < first[from + 1]; ++x)
+        {
+            search.label(x, 0, -1);
+        }
+
+        const int *st = station.data();
+        int hit = search.settle(g, [st, to](int u) { return st[u] == to; });
+        if(hit < 0)
+            return vector<int>();
+        return search.path(hit);
+    }
+
+    vector<int> route(Dijkstra<double> &search, int from, int to, const GeoBound &geo) const
+    {
+        search.reset(g.n);
+        double h = geo.estimate(from, to);
+        for(int x = first[from]; x < first[from + 1]; ++x)
+        {
+            search.label(x, 0, -1, h);
+        }
+
+        const int *st = station.data();
+        int hit = search.settle(g, [st, to](int u) { return st[u] == to; }, [&geo, st, to](int u) { return geo.estimate(st[u], to); });
+        if(hit < 0)
+            return vector<int>();
+        return search.path(hit);
+    }
+
+    template<class W>
+    vector<int> route(Dijkstra<W> &fwd, Dijkstra<W> &bwd, int from, int to) const
+    {
+        fwd.reset(g.n);
+        bwd.reset(g.n);
+        for(int x = first[from]; x < first[from + 1]; ++x)
+        {
+            fwd.label(x, 0, -1);
+        }
+        for(int x = first[to]; x < first[to + 1]; ++x)
+        {
+            bwd.label(x, 0, -1);
+        }
+        return meetInMiddle(g, fwd, bwd);
+    }
+
+    void measure(const vector<int> &states, bool byCost, int &totalCost, double &totalDistance, int &interchanges) const
+    {
+        totalCost = 0;
+        totalDistance = 0;
+        interchanges = 0;
+        bool moved = false;
+        for(int i = 1; i < (int)states.size(); ++i)
+        {
+            int u = states[i - 1];
+            int v = states[i];
+            if(station[u] == station[v])
+            {
+                if(moved) ++interchanges;
+                continue;
+            }
+            moved = true;
+            int e = g.findArc(u, v, byCost);
+            totalCost += g.cost[e];
+            totalDistance += g.distance[e];
+        }
+    }
+
+    // Fewest line changes along a fixed station path: ride each line as far as it goes before switching.
+    // The stations where the changes happen go to at, if given.
+    int interchanges(const vector<int> &path, vector<int> *at = NULL) const
+    {
+        int changes = -1;
+        int i = 0;
+        while(i + 1 < (int)path.size())
+        {
+            if(at && changes >= 0)
+                at->push_back(path[i]);
+            uint64_t ride = lines[path[i]];
+            int j = i;
+            while(j + 1 < (int)path.size() && (ride & lines[path[j + 1]]))
+            {
+                ride &= lines[path[++j]];
+            }
+            ++changes;
+            i = max(j, i + 1);
+        }
+        return max(changes, 0);
+    }
+
+    bool serves(int st, int ln) const
+    {
+        return ln >= 0 && (lines[st] >> ln & 1);
+    }
+
+    string lineName(int state) const
+    {
+        return line[state] < 0 ? "Unmarked" : lineNames[line[state]];
+    }
+};
+
+template<class W>
+class KShortest
+{
+public:
+    Dijkstra<W> toDest;
+    Dijkstra<W> search;
+    vector<unsigned> banned;
+    unsigned banRound;
+    vector<int> bannedNext;
+
+    KShortest()
+    {
+        banRound = 0;
+    }
+
+    W weight(const Graph &g, const vector<int> &path, int upto) const
+    {
+        W total = 0;
+        const vector<W> &w = g.weights(W());
+        for(int i = 1; i <= upto; ++i)
+        {
+            total += w[g.findArc(path[i - 1], path[i], is_same<W, int>::value)];
+        }
+        return total;
+    }
+
+    // A* from the spur station; exact distances to dest in the unrestricted graph are an admissible, consistent heuristic.
+    bool spur(const Graph &g, int from, int dest, vector<int> &out)
+    {
+        out.clear();
+        const vector<W> &w = g.weights(W());
+
+        int v = from;
+        while(v != dest && toDest.reached(v) && (v == from || banned[v] != banRound))
+        {
+            int next = toDest.parent[v];
+            if(v == from && find(bannedNext.begin(), bannedNext.end(), next) != bannedNext.end()) break;
+            out.push_back(v);
+            v = next;
+        }
+        if(v == dest)
+        {
+            out.push_back(dest);
+            return true;
+        }
+
+        out.clear();
+        search.reset(g.n);
+        search.label(from, 0, -1, toDest.get(from));
+        while(!search.heap.empty())
+        {
+            pair<W, int> x = search.heap.pop();
+            W f = x.first;
+            int u = x.second;
+
+            if(f > search.best[u] + toDest.get(u)) continue;
+            if(u == dest)
+            {
+                out = search.path(dest);
+                return true;
+            }
+
+            for(int e = g.offset[u]; e < g.offset[u + 1]; ++e)
+            {
+                int x = g.target[e];
+                if(banned[x] == banRound || !toDest.reached(x)) continue;
+                if(u == from && find(bannedNext.begin(), bannedNext.end(), x) != bannedNext.end()) continue;
+
+                W nd = search.best[u] + w[e];
+                if(nd < search.get(x))
+                {
+                    search.label(x, nd, u, nd + toDest.get(x));
+                }
+            }
+        }
+        return false;
+    }
+
+    // Yen's algorithm: up to k loopless routes from src to dest in increasing order of W.
+    vector<pair<W, vector<int>>> run(const Graph &g, int src, int dest, int k)
+    {
+        vector<pair<W, vector<int>>> found;
+        toDest.run(g, dest, -1);
+        if(!toDest.reached(src) || k <= 0)
+            return found;
+
+        if(banned.size() != (size_t)g.n)
+        {
+            banned.assign(g.n, 0);
+            banRound = 0;
+        }
+
+        vector<int> first;
+        for(int v = src; v != -1; v = toDest.parent[v])
+        {
+            first.push_back(v);
+        }
+        found.push_back({toDest.get(src), first});
+
+        vector<pair<W, vector<int>>> candidates;
+        auto later = [](const pair<W, vector<int>> &a, const pair<W, vector<int>> &b) { return a.first > b.first; };
+        vector<int> tail;
+
+        while((int)found.size() < k)
+        {
+            const vector<int> last = found.back().second;
+            for(int i = 0; i + 1 < (int)last.size(); ++i)
+            {
+                if(++banRound == 0)
+                {
+                    fill(banned.begin(), banned.end(), 0);
+                    banRound = 1;
+                }
+                for(int j = 0; j < i; ++j)
+                {
+                    banned[last[j]] = banRound;
+                }
+
+                bannedNext.clear();
+                for(auto &p : found)
+                {
+                    if((int)p.second.size() > i + 1 && equal(last.begin(), last.begin() + i + 1, p.second.begin()))
+                        bannedNext.push_back(p.second[i + 1]);
+                }
+
+                if(!spur(g, last[i], dest, tail)) continue;
+
+                vector<int> path(last.begin(), last.begin() + i);
+                path.insert(path.end(), tail.begin(), tail.end());
+
+                bool seen = false;
+                for(auto &p : candidates)
+                {
+                    if(p.second == path) seen = true;
+                }
+                if(seen) continue;
+
+                candidates.push_back({weight(g, path, path.size() - 1), path});
+                push_heap(candidates.begin(), candidates.end(), later);
+            }
+
+            if(candidates.empty()) break;
+            pop_heap(candidates.begin(), candidates.end(), later);
+            found.push_back(candidates.back());
+            candidates.pop_back();
+        }
+        return found;
+    }
+};
+
+int parseClock(const string &text)
+{
+    int h, mm;
+    char colon;
+    istringstream in(text);
+    if(!(in >> h >> colon >> mm) || colon != ':' || h < 0 || h > 47 || mm < 0 || mm > 59)
+        return -1;
+    return h * 3600 + mm * 60;
+}
+
+string clockText(int seconds)
+{
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%02d:%02d", seconds / 3600 % 24, seconds / 60 % 60);
+    return buf;
+}
+
+class LineService
+{
+public:
+    int headway;
+    int dwell;
+    int firstTrain;
+    int lastTrain;
+    double speed;
+
+    LineService()
+    {
+        headway = 300;
+        dwell = 30;
+        firstTrain = 6 * 3600;
+        lastTrain = 23 * 3600;
+        speed = 34;
+    }
+};
+
+class Timetable
+{
+public:
+    unordered_map<string, LineService> services;
+    LineService defaults;
+    int interchangeTime;
+
+    vector<int> routeLine;
+    vector<int> stopOffset;
+    vector<int> stops;
+    vector<int> tripOffset;
+    vector<int> trips;
+    vector<int> dwell;
+    vector<int> times;
+    vector<int> servingOffset;
+    vector<pair<int, int>> serving;
+
+    Timetable()
+    {
+        interchangeTime = 180;
+    }
+
+    // Lines of "<line> <headway min> <dwell sec> <first HH:MM> <last HH:MM> <speed km/h>" or "interchange <sec>".
+    bool loadConfig(const string &path)
+    {
+        ifstream in(path);
+        if(!in)
+            return false;
+
+        string text;
+        while(getline(in, text))
+        {
+            istringstream row(text);
+            string name;
+            if(!(row >> name) || name[0] == '#')
+                continue;
+            if(name == "interchange")
+            {
+                int seconds;
+                if(row >> seconds && seconds >= 0)
+                    interchangeTime = seconds;
+                continue;
+            }
+
+            LineService x;
+            string first, last;
+            double headway;
+            // A headway under a second would round to zero and addRoute would never stop adding trains.
+            if(row >> headway >> x.dwell >> first >> last >> x.speed && parseClock(first) >= 0 && parseClock(last) >= 0 && headway * 60 >= 1 && headway <= 24 * 60 && x.speed > 0)
+            {
+                x.headway = headway * 60;
+                x.firstTrain = parseClock(first);
+                x.lastTrain = parseClock(last);
+                services[name] = x;
+            }
+        }
+        return true;
+    }
+
+    const LineService &service(const string &line) const
+    {
+        auto it = services.find(line);
+        return it == services.end() ? defaults : it->second;
+    }
+
+    int size(int r) const
+    {
+        return stopOffset[r + 1] - stopOffset[r];
+    }
+
+    int arrival(int r, int t, int i) const
+    {
+        return times[tripOffset[r] + t * size(r) + i];
+    }
+
+    int departure(int r, int t, int i) const
+    {
+        return arrival(r, t, i) + (i > 0 ? dwell[r] : 0);
+    }
+
+    int earliestTrip(int r, int i, int time) const
+    {
+        int lo = 0;
+        int hi = trips[r];
+        while(lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+            if(departure(r, mid, i) >= time)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        return lo < trips[r] ? lo : -1;
+    }
+
+    void addRoute(int ln, const vector<int> &path, const vector<double> &km, const LineService &x)
+    {
+        routeLine.push_back(ln);
+        stops.insert(stops.end(), path.begin(), path.end());
+        stopOffset.push_back(stops.size());
+        dwell.push_back(x.dwell);
+
+        int count = 0;
+        for(int start = x.firstTrain; start <= x.lastTrain; start += x.headway, ++count)
+        {
+            int t = start;
+            times.push_back(t);
+            for(int i = 0; i + 1 < (int)path.size(); ++i)
+            {
+                t += (i > 0 ? x.dwell : 0) + max(30, (int)(km[i] / x.speed * 3600 + 0.5));
+                times.push_back(t);
+            }
+        }
+        trips.push_back(count);
+        tripOffset.push_back(times.size());
+    }
+
+    // Each line is split into trails over its own segments; every trail runs in both directions from first to last train.
+    void build(const LineGraph &lg)
+    {
+        int n = lg.first.size() - 1;
+        routeLine.clear();
+        stops.clear();
+        stopOffset.assign(1, 0);
+        trips.clear();
+        times.clear();
+        tripOffset.assign(1, 0);
+        dwell.clear();
+
+        for(int ln = 0; ln < (int)lg.lineNames.size(); ++ln)
+        {
+            vector<Segment> edges;
+            for(int x = 0; x < lg.g.n; ++x)
+            {
+                if(lg.line[x] != ln) continue;
+                for(int e = lg.g.offset[x]; e < lg.g.offset[x + 1]; ++e)
+                {
+                    int y = lg.g.target[e];
+                    if(lg.line[y] == ln && lg.station[x] < lg.station[y])
+                        edges.push_back(Segment(lg.station[x], lg.station[y], lg.g.cost[e], lg.g.distance[e]));
+                }
+            }
+
+            unordered_map<int, vector<int>> touching;
+            for(int i = 0; i < (int)edges.size(); ++i)
+            {
+                touching[edges[i].a].push_back(i);
+                touching[edges[i].b].push_back(i);
+            }
+            vector<bool> used(edges.size(), false);
+            int left = edges.size();
+            const LineService &x = service(lg.lineNames[ln]);
+
+            while(left > 0)
+            {
+                int start = -1;
+                for(auto &t : touching)
+                {
+                    int free = 0;
+                    for(int i : t.second) free += !used[i];
+                    if(free == 1 && (start < 0 || t.first < start)) start = t.first;
+                }
+                for(int i = 0; start < 0 && i < (int)edges.size(); ++i)
+                {
+                    if(!used[i]) start = edges[i].a;
+                }
+
+                vector<int> path(1, start);
+                vector<double> km;
+                for(bool moved = true; moved;)
+                {
+                    moved = false;
+                    for(int i : touching[path.back()])
+                    {
+                        if(used[i]) continue;
+                        used[i] = true;
+                        --left;
+                        path.push_back(edges[i].a == path.back() ? edges[i].b : edges[i].a);
+                        km.push_back(edges[i].distance);
+                        moved = true;
+                        break;
+                    }
+                }
+
+                addRoute(ln, path, km, x);
+                reverse(path.begin(), path.end());
+                reverse(km.begin(), km.end());
+                addRoute(ln, path, km, x);
+            }
+        }
+
+        servingOffset.assign(n + 1, 0);
+        for(int r = 0; r < (int)routeLine.size(); ++r)
+        {
+            for(int i = stopOffset[r]; i < stopOffset[r + 1]; ++i)
+            {
+                ++servingOffset[stops[i] + 1];
+            }
+        }
+        for(int i = 0; i < n; ++i)
+        {
+            servingOffset[i + 1] += servingOffset[i];
+        }
+        serving.resize(servingOffset[n]);
+        vector<int> next(servingOffset.begin(), servingOffset.end() - 1);
+        for(int r = 0; r < (int)routeLine.size(); ++r)
+        {
+            for(int i = stopOffset[r]; i < stopOffset[r + 1]; ++i)
+            {
+                serving[next[stops[i]]++] = {r, i - stopOffset[r]};
+            }
+        }
+    }
+};
+
+class TimetableLeg
+{
+public:
+    int route;
+    int trip;
+    int board;
+    int alight;
+};
+
+class Raptor
+{
+public:
+    static constexpr int ROUNDS = 8;
+    static constexpr int NEVER = INT_MAX;
+
+    int n;
+    vector<int> tau;
+    vector<int> earliest;
+    vector<int> legRoute;
+    vector<int> legTrip;
+    vector<int> legBoard;
+    vector<int> legAlight;
+    vector<char> marked;
+    vector<int> markedList;
+    vector<int> queue;
+    vector<int> queued;
+
+    Raptor()
+    {
+        n = 0;
+    }
+
+    void reset(const Timetable &tt)
+    {
+        n = tt.servingOffset.size() - 1;
+        tau.assign((ROUNDS + 1) * n, NEVER);
+        earliest.assign(n, NEVER);
+        legRoute.assign((ROUNDS + 1) * n, -1);
+        legTrip.assign((ROUNDS + 1) * n, -1);
+        legBoard.assign((ROUNDS + 1) * n, -1);
+        legAlight.assign((ROUNDS + 1) * n, -1);
+        marked.assign(n, 0);
+        markedList.clear();
+        queue.assign(tt.routeLine.size(), -1);
+        queued.clear();
+    }
+
+    void mark(int p)
+    {
+        if(!marked[p])
+        {
+            marked[p] = 1;
+            markedList.push_back(p);
+        }
+    }
+
+    // One RAPTOR pass from a departure at from; labels already in tau stay valid, which is what range queries rely on.
+    void rounds(const Timetable &tt, int from, int to, int depart)
+    {
+        if(depart < tau[from])
+        {
+            tau[from] = depart;
+            earliest[from] = min(earliest[from], depart);
+        }
+        mark(from);
+
+        for(int k = 1; k <= ROUNDS && markedList.size(); ++k)
+        {
+            int *prev = &tau[(k - 1) * n];
+            int *cur = &tau[k * n];
+
+            for(int p : markedList)
+            {
+                marked[p] = 0;
+                for(int x = tt.servingOffset[p]; x < tt.servingOffset[p + 1]; ++x)
+                {
+                    int r = tt.serving[x].first;
+                    int i = tt.serving[x].second;
+                    if(queue[r] < 0)
+                        queued.push_back(r);
+                    if(queue[r] < 0 || i < queue[r])
+                        queue[r] = i;
+                }
+            }
+            markedList.clear();
+
+            for(int r : queued)
+            {
+                int t = -1;
+                int board = -1;
+                const int *path = &tt.stops[tt.stopOffset[r]];
+                for(int j = queue[r]; j < tt.size(r); ++j)
+                {
+                    int p = path[j];
+                    if(t >= 0)
+                    {
+                        int a = tt.arrival(r, t, j);
+                        if(a < earliest[p] && a < earliest[to])
+                        {
+                            cur[p] = a;
+                            earliest[p] = a;
+                            legRoute[k * n + p] = r;
+                            legTrip[k * n + p] = t;
+                            legBoard[k * n + p] = board;
+                            legAlight[k * n + p] = j;
+                            mark(p);
+                        }
+                    }
+
+                    if(prev[p] != NEVER)
+                    {
+                        int ready = prev[p] + (k > 1 ? tt.interchangeTime : 0);
+                        if(t < 0 || ready <= tt.departure(r, t, j))
+                        {
+                            int nt = tt.earliestTrip(r, j, ready);
+                            if(nt >= 0 && (t < 0 || nt < t))
+                            {
+                                t = nt;
+                                board = j;
+                            }
+                        }
+                    }
+                }
+                queue[r] = -1;
+            }
+            queued.clear();
+        }
+        for(int p : markedList)
+        {
+            marked[p] = 0;
+        }
+        markedList.clear();
+    }
+
+    int bestRound(int to) const
+    {
+        int best = -1;
+        for(int k = 0; k <= ROUNDS; ++k)
+        {
+            if(tau[k * n + to] != NEVER && (best < 0 || tau[k * n + to] < tau[best * n + to]))
+                best = k;
+        }
+        return best;
+    }
+
+    vector<TimetableLeg> journey(const Timetable &tt, int to, int k) const
+    {
+        vector<TimetableLeg> legs;
+        for(int p = to; k > 0 && legRoute[k * n + p] >= 0; --k)
+        {
+            TimetableLeg leg;
+            leg.route = legRoute[k * n + p];
+            leg.trip = legTrip[k * n + p];
+            leg.board = legBoard[k * n + p];
+            leg.alight = legAlight[k * n + p];
+            const int *path = &tt.stops[tt.stopOffset[leg.route]];
+            legs.push_back(leg);
+            p = path[leg.board];
+        }
+        reverse(legs.begin(), legs.end());
+        return legs;
+    }
+
+    vector<TimetableLeg> earliestArrival(const Timetable &tt, int from, int to, int depart)
+    {
+        reset(tt);
+        rounds(tt, from, to, depart);
+        int k = bestRound(to);
+        return k < 0 ? vector<TimetableLeg>() : journey(tt, to, k);
+    }
+
+    // rRAPTOR: departures from the source inside [start, end] are replayed latest first over shared labels.
+    vector<pair<int, vector<TimetableLeg>>> profile(const Timetable &tt, int from, int to, int start, int end)
+    {
+        vector<int> departures;
+        for(int x = tt.servingOffset[from]; x < tt.servingOffset[from + 1]; ++x)
+        {
+            int r = tt.serving[x].first;
+            int i = tt.serving[x].second;
+            if(i + 1 == tt.size(r)) continue;
+            for(int t = tt.earliestTrip(r, i, start); t >= 0 && t < tt.trips[r] && tt.departure(r, t, i) <= end; ++t)
+            {
+                departures.push_back(tt.departure(r, t, i));
+            }
+        }
+        sort(departures.rbegin(), departures.rend());
+        departures.erase(unique(departures.begin(), departures.end()), departures.end());
+
+        reset(tt);
+        vector<pair<int, vector<TimetableLeg>>> options;
+        int arrival = NEVER;
+        for(int d : departures)
+        {
+            rounds(tt, from, to, d);
+            int k = bestRound(to);
+            if(k < 0 || tau[k * n + to] >= arrival) continue;
+            arrival = tau[k * n + to];
+            options.push_back({d, journey(tt, to, k)});
+        }
+        reverse(options.begin(), options.end());
+        return options;
+    }
+};
+
+class SearchWork
+{
+public:
+    long long settled;
+    long long relaxed;
+    long long pushed;
+    long long stale;
+};
+
+class RouteWorker
+{
+public:
+    Dijkstra<int> cost;
+    Dijkstra<double> dist;
+    Dijkstra<int> stateCost;
+    Dijkstra<double> stateDist;
+    Dijkstra<int> costBack;
+    Dijkstra<double> distBack;
+    Dijkstra<int> stateCostBack;
+    Dijkstra<double> stateDistBack;
+
+    // Running totals over every search this worker has made; a query's work is the difference across it.
+    SearchWork work() const
+    {
+        SearchWork x = {cost.settled + dist.settled + stateCost.settled + stateDist.settled +
+                        costBack.settled + distBack.settled + stateCostBack.settled + stateDistBack.settled,
+                        cost.relaxed + dist.relaxed + stateCost.relaxed + stateDist.relaxed +
+                        costBack.relaxed + distBack.relaxed + stateCostBack.relaxed + stateDistBack.relaxed,
+                        cost.pushed + dist.pushed + stateCost.pushed + stateDist.pushed +
+                        costBack.pushed + distBack.pushed + stateCostBack.pushed + stateDistBack.pushed,
+                        cost.stale + dist.stale + stateCost.stale + stateDist.stale +
+                        costBack.stale + distBack.stale + stateCostBack.stale + stateDistBack.stale};
+        return x;
+    }
+};
+
+class RouteResult
+{
+public:
+    vector<int> path;
+    vector<int> states;
+    int cost;
+    double distance;
+    int interchanges;
+};
+
+class RouteCache
+{
+public:
+    class Entry
+    {
+    public:
+        uint64_t key;
+        bool found;
+        double value;
+        RouteResult route;
+    };
+
+    class Shard
+    {
+    public:
+        mutex lock;
+        list<Entry> order;
+        unordered_map<uint64_t, list<Entry>::iterator> index;
+    };
+
+    static constexpr int SHARDS = 16;
+    Shard shards[SHARDS];
+    size_t perShard;
+    atomic<long long> hits;
+    atomic<long long> misses;
+    atomic<long long> evictions;
+    atomic<long long> invalidations;
+
+    RouteCache()
+    {
+        perShard = 256;
+        hits = 0;
+        misses = 0;
+        evictions = 0;
+        invalidations = 0;
+    }
+
+    // criterion: bit 0 set for cost, bit 1 set for line-aware routing.
+    static uint64_t key(int from, int to, int criterion)
+    {
+        return (uint64_t)from << 34 | (uint64_t)to << 2 | criterion;
+    }
+
+    Shard &shard(uint64_t k)
+    {
+        return shards[(k * 0x9E3779B97F4A7C15ULL) >> 60];
+    }
+
+    void setCapacity(size_t total)
+    {
+        perShard = (total + SHARDS - 1) / SHARDS;
+        for(Shard &x : shards)
+        {
+            lock_guard<mutex> guard(x.lock);
+            while(x.order.size() > perShard)
+            {
+                x.index.erase(x.order.back().key);
+                x.order.pop_back();
+            }
+        }
+    }
+
+    bool lookup(uint64_t k, RouteResult &r, bool &found)
+    {
+        Shard &x = shard(k);
+        lock_guard<mutex> guard(x.lock);
+        auto it = x.index.find(k);
+        if(it == x.index.end())
+        {
+            ++misses;
+            return false;
+        }
+        x.order.splice(x.order.begin(), x.order, it->second);
+        r = it->second->route;
+        found = it->second->found;
+        ++hits;
+        return true;
+    }
+
+    void store(uint64_t k, const RouteResult &r, bool found, double value)
+    {
+        if(perShard == 0) return;
+
+        Shard &x = shard(k);
+        lock_guard<mutex> guard(x.lock);
+        auto it = x.index.find(k);
+        if(it != x.index.end())
+        {
+            x.order.erase(it->second);
+            x.index.erase(it);
+        }
+        x.order.push_front(Entry{k, found, value, r});
+        x.index[k] = x.order.begin();
+        if(x.order.size() > perShard)
+        {
+            x.index.erase(x.order.back().key);
+            x.order.pop_back();
+            ++evictions;
+        }
+    }
+
+    // Drops every entry for which stale(from, to, criterion, value, route) holds; value is infinite for unreachable pairs.
+    template<class Stale>
+    void removeIf(Stale stale)
+    {
+        for(Shard &x : shards)
+        {
+            lock_guard<mutex> guard(x.lock);
+            for(auto it = x.order.begin(); it != x.order.end();)
+            {
+                uint64_t k = it->key;
+                if(stale((int)(k >> 34), (int)(k >> 2 & 0xFFFFFFFFULL), (int)(k & 3), it->found ? it->value : numeric_limits<double>::infinity(), it->route))
+                {
+                    x.index.erase(k);
+                    it = x.order.erase(it);
+                    ++invalidations;
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    size_t size()
+    {
+        size_t total = 0;
+        for(Shard &x : shards)
+        {
+            lock_guard<mutex> guard(x.lock);
+            total += x.order.size();
+        }
+        return total;
+    }
+};
+
+// Log-linear buckets: values below 16 exactly, then eight per power of two, so a bucket's lower edge is within 12.5%
+// of every value in it. Recording is a few relaxed atomic adds, so any number of threads may share one histogram.
+class Histogram
+{
+public:
+    static constexpr int BUCKETS = 16 + 60 * 8;
+    atomic<uint64_t> counts[BUCKETS];
+    atomic<uint64_t> total;
+    atomic<uint64_t> largest;
+
+    Histogram()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for(atomic<uint64_t> &x : counts)
+        {
+            x.store(0, memory_order_relaxed);
+        }
+        total.store(0, memory_order_relaxed);
+        largest.store(0, memory_order_relaxed);
+    }
+
+    static int bucket(uint64_t v)
+    {
+        if(v < 16) return (int)v;
+        uint64_t x = v;
+        int b = 0;
+        if(x >> 32) { x >>= 32; b += 32; }
+        if(x >> 16) { x >>= 16; b += 16; }
+        if(x >> 8) { x >>= 8; b += 8; }
+        if(x >> 4) { x >>= 4; b += 4; }
+        if(x >> 2) { x >>= 2; b += 2; }
+        if(x >> 1) b += 1;
+        return 16 + (b - 4) * 8 + (int)(v >> (b - 3) & 7);
+    }
+
+    // Smallest value that falls in bucket i.
+    static uint64_t lower(int i)
+    {
+        if(i < 16) return i;
+        return (uint64_t)(8 + (i - 16) % 8) << ((i - 16) / 8 + 1);
+    }
+
+    void record(uint64_t v)
+    {
+        counts[bucket(v)].fetch_add(1, memory_order_relaxed);
+        total.fetch_add(v, memory_order_relaxed);
+        uint64_t high = largest.load(memory_order_relaxed);
+        while(v > high && !largest.compare_exchange_weak(high, v, memory_order_relaxed)) { }
+    }
+
+    // Quantiles are the upper edge of the bucket they fall in, so they never understate a tail.
+    void write(ostream &out) const
+    {
+        uint64_t snapshot[BUCKETS];
+        uint64_t n = 0;
+        for(int i = 0; i < BUCKETS; ++i)
+        {
+            snapshot[i] = counts[i].load(memory_order_relaxed);
+            n += snapshot[i];
+        }
+        uint64_t sum = total.load(memory_order_relaxed);
+        uint64_t high = largest.load(memory_order_relaxed);
+
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.1f", n ? (double)sum / n : 0.0);
+        out << "{\"count\":" << n << ",\"sum\":" << sum << ",\"mean\":" << buf << ",\"max\":" << high;
+        const double ps[] = {0.5, 0.9, 0.99, 0.999};
+        const char *names[] = {"p50", "p90", "p99", "p999"};
+        for(int k = 0; k < 4; ++k)
+        {
+            uint64_t rank = (uint64_t)ceil(ps[k] * n);
+            uint64_t seen = 0;
+            uint64_t value = 0;
+            for(int i = 0; n && i < BUCKETS; ++i)
+            {
+                seen += snapshot[i];
+                if(seen >= rank)
+                {
+                    value = i + 1 < BUCKETS ? min(high, lower(i + 1) - 1) : high;
+                    break;
+                }
+            }
+            out << ",\"" << names[k] << "\":" << value;
+        }
+        out << ",\"buckets\":[";
+        bool first = true;
+        for(int i = 0; i < BUCKETS; ++i)
+        {
+            if(!snapshot[i]) continue;
+            out << (first ? "" : ",") << "[" << lower(i) << "," << snapshot[i] << "]";
+            first = false;
+        }
+        out << "]}";
+    }
+};
+
+// What each route query cost, split so a slow answer can be put down to the search, printing it or the socket.
+// Nothing is recorded unless enabled is set before the first query.
+class QueryMetrics
+{
+public:
+    enum Kind { SETTLED, RELAXED, PUSHED, STALE, SEARCH, ANSWER, PRINT, REPLY, KINDS };
+
+    bool enabled;
+    chrono::steady_clock::time_point since;
+    atomic<long long> queries;
+    atomic<long long> found;
+    atomic<long long> cached;
+    Histogram histograms[KINDS];
+
+    QueryMetrics()
+    {
+        enabled = false;
+        since = chrono::steady_clock::now();
+        queries = 0;
+        found = 0;
+        cached = 0;
+    }
+
+    static const char *name(int kind)
+    {
+        static const char *names[KINDS] = {"settled", "relaxed", "pushed", "stale_pops", "search_ns", "answer_ns", "print_ns", "reply_ns"};
+        return names[kind];
+    }
+
+    static uint64_t nanos(chrono::steady_clock::time_point started)
+    {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count();
+    }
+
+    void time(Kind kind, chrono::steady_clock::time_point started)
+    {
+        histograms[kind].record(nanos(started));
+    }
+
+    void query(const SearchWork &before, const SearchWork &after, chrono::steady_clock::time_point started, bool routed, bool hit)
+    {
+        histograms[SEARCH].record(nanos(started));
+        histograms[SETTLED].record(after.settled - before.settled);
+        histograms[RELAXED].record(after.relaxed - before.relaxed);
+        histograms[PUSHED].record(after.pushed - before.pushed);
+        histograms[STALE].record(after.stale - before.stale);
+        queries.fetch_add(1, memory_order_relaxed);
+        found.fetch_add(routed, memory_order_relaxed);
+        cached.fetch_add(hit, memory_order_relaxed);
+    }
+
+    // One line of JSON; histograms with nothing recorded are left out.
+    void write(ostream &out) const
+    {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.3f", chrono::duration<double>(chrono::steady_clock::now() - since).count());
+        out << "{\"uptime_s\":" << buf << ",\"queries\":" << queries.load() << ",\"found\":" << found.load() <<
+               ",\"cached\":" << cached.load();
+        for(int k = 0; k < KINDS; ++k)
+        {
+            if(!histograms[k].largest.load(memory_order_relaxed) && !histograms[k].counts[0].load(memory_order_relaxed))
+                continue;
+            out << ",\"" << name(k) << "\":";
+            histograms[k].write(out);
+        }
+        out << "}";
+    }
+};
+
+QueryMetrics metrics;
+
+// Read-only over net, states, table, hubs and ch, so any number of threads may call it with their own worker.
+// Plain queries use the route table, then hub labels, then the hierarchy, before searching. With geo set, distance queries run A* when every station has coordinates and cost queries search from both ends.
+bool findRoute(const Graph &net, const LineGraph &states, const RouteTable *table, const HubLabels *hubs, const Hierarchy *ch, const GeoBound *geo, RouteWorker &w, int from, int to, bool byCost, bool lineAware, RouteResult &r, RouteCache *cache = NULL)
+{
+    chrono::steady_clock::time_point started;
+    SearchWork before = {0, 0, 0, 0};
+    if(metrics.enabled)
+    {
+        started = chrono::steady_clock::now();
+        before = w.work();
+    }
+
+    uint64_t k = RouteCache::key(from, to, (byCost ? 1 : 0) | (lineAware ? 2 : 0));
+    bool found;
+    if(cache && cache->lookup(k, r, found))
+    {
+        if(metrics.enabled)
+            metrics.query(before, before, started, found, true);
+        return found;
+    }
+
+    r.path.clear();
+    r.states.clear();
+    found = false;
+    double value = 0;
+    if(lineAware)
+    {
+        if(!geo)
+            r.states = byCost ? states.route(w.stateCost, from, to) : states.route(w.stateDist, from, to);
+        else if(!byCost && geo->usable)
+            r.states = states.route(w.stateDist, from, to, *geo);
+        else
+            r.states = byCost ? states.route(w.stateCost, w.stateCostBack, from, to) : states.route(w.stateDist, w.stateDistBack, from, to);
+        if(r.states.size())
+        {
+            states.measure(r.states, byCost, r.cost, r.distance, r.interchanges);
+            for(int x : r.states)
+            {
+                if(r.path.empty() || r.path.back() != states.station[x])
+                    r.path.push_back(states.station[x]);
+            }
+            value = byCost ? r.cost + r.interchanges * states.transferCost : r.distance + r.interchanges * states.transferDistance;
+            found = true;
+        }
+    }
+    else
+    {
+        if(table)
+            r.path = table->walk(byCost ? table->nextByCost : table->nextByDist, from, to);
+        else if(hubs)
+            r.path = byCost ? hubs->cost.path(from, to) : hubs->dist.path(from, to);
+        else if(ch)
+            r.path = byCost ? ch->route(w.cost, w.costBack, from, to, ch->costVia) : ch->route(w.dist, w.distBack, from, to, ch->distVia);
+        else if(geo && !byCost && geo->usable)
+        {
+            if(w.dist.run(net, from, to, [geo, to](int u) { return geo->estimate(u, to); }))
+                r.path = w.dist.path(to);
+        }
+        else if(geo)
+        {
+            if(byCost)
+            {
+                w.cost.reset(net.n);
+                w.costBack.reset(net.n);
+                w.cost.label(from, 0, -1);
+                w.costBack.label(to, 0, -1);
+                r.path = meetInMiddle(net, w.cost, w.costBack);
+            }
+            else
+            {
+                w.dist.reset(net.n);
+                w.distBack.reset(net.n);
+                w.dist.label(from, 0, -1);
+                w.distBack.label(to, 0, -1);
+                r.path = meetInMiddle(net, w.dist, w.distBack);
+            }
+        }
+        else if(byCost ? w.cost.run(net, from, to) : w.dist.run(net, from, to))
+            r.path = byCost ? w.cost.path(to) : w.dist.path(to);
+
+        if(r.path.size())
+        {
+            net.measure(r.path, byCost, r.cost, r.distance);
+            r.interchanges = states.interchanges(r.path);
+            value = byCost ? r.cost : r.distance;
+            found = true;
+        }
+    }
+
+    if(cache)
+        cache->store(k, r, found, value);
+    if(metrics.enabled)
+        metrics.query(before, w.work(), started, found, false);
+    return found;
+}
+
+class ParetoLabel
+{
+public:
+    int cost;
+    double distance;
+    int transfers;
+    int state;
+    int parent;
+
+    bool covers(int c, double d, int t) const
+    {
+        return cost <= c && distance <= d + 1e-9 && transfers <= t;
+    }
+};
+
+class ParetoSearch
+{
+public:
+    vector<ParetoLabel> labels;
+    vector<vector<int>> bags;
+    vector<int> touched;
+    vector<int> found;
+    vector<int> heap;
+    Dijkstra<int> lowCost;
+    Dijkstra<double> lowDist;
+
+    // Label-setting search over (cost, distance, interchanges); labels whose optimistic completion is
+    // already matched by a route to the destination are dropped before they enter the queue.
+    vector<int> run(const Graph &net, const LineGraph &states, int from, int to)
+    {
+        for(int v : touched)
+        {
+            bags[v].clear();
+        }
+        touched.clear();
+        bags.resize(states.g.n);
+        labels.clear();
+        found.clear();
+        heap.clear();
+
+        lowCost.run(net, to, -1);
+        lowDist.run(net, to, -1);
+
+        auto later = [this](int a, int b)
+        {
+            const ParetoLabel &x = labels[a];
+            const ParetoLabel &y = labels[b];
+            if(x.cost != y.cost) return x.cost > y.cost;
+            if(x.distance != y.distance) return x.distance > y.distance;
+            return x.transfers > y.transfers;
+        };
+        auto dominated = [this, &states](int v, int c, double d, int t)
+        {
+            for(int k : bags[v])
+            {
+                if(labels[k].covers(c, d, t)) return true;
+            }
+            int st = states.station[v];
+            if(!lowCost.reached(st)) return true;
+            c += lowCost.get(st);
+            d += lowDist.get(st);
+            for(int k : found)
+            {
+                if(labels[k].covers(c, d, t)) return true;
+            }
+            return false;
+        };
+        auto push = [&](int v, int c, double d, int t, int parent)
+        {
+            if(dominated(v, c, d, t)) return;
+            labels.push_back({c, d, t, v, parent});
+            heap.push_back(labels.size() - 1);
+            push_heap(heap.begin(), heap.end(), later);
+        };
+
+        for(int x = states.first[from]; x < states.first[from + 1]; ++x)
+        {
+            push(x, 0, 0, 0, -1);
+        }
+
+        const Graph &g = states.g;
+        while(!heap.empty())
+        {
+            pop_heap(heap.begin(), heap.end(), later);
+            int k = heap.back();
+            heap.pop_back();
+
+            ParetoLabel cur = labels[k];
+            int u = cur.state;
+            if(dominated(u, cur.cost, cur.distance, cur.transfers)) continue;
+
+            if(bags[u].empty()) touched.push_back(u);
+            bags[u].push_back(k);
+            if(states.station[u] == to)
+            {
+                found.push_back(k);
+                continue;
+            }
+
+            for(int e = g.offset[u]; e < g.offset[u + 1]; ++e)
+            {
+                int v = g.target[e];
+                if(states.station[v] == states.station[u])
+                    push(v, cur.cost, cur.distance, cur.transfers + 1, k);
+                else
+                    push(v, cur.cost + g.cost[e], cur.distance + g.distance[e], cur.transfers, k);
+            }
+        }
+        return found;
+    }
+
+    vector<int> path(int k) const
+    {
+        vector<int> walk;
+        for(; k != -1; k = labels[k].parent)
+        {
+            walk.push_back(labels[k].state);
+        }
+        reverse(walk.begin(), walk.end());
+        return walk;
+    }
+};
+
+// Every station within a budget of one source, in increasing order of the budgeted quantity; the search stops at the
+// first station over budget. Fares and distances follow the plain network. Interchanges come from a 0-1 search over the
+// line graph where riding is free and changing line costs one.
+class Isochrone
+{
+public:
+    static constexpr int FARE = 0;
+    static constexpr int DISTANCE = 1;
+    static constexpr int INTERCHANGES = 2;
+
+    Dijkstra<int> cost;
+    Dijkstra<double> dist;
+    vector<int> level;
+    vector<unsigned> labelled;
+    vector<unsigned> closed;
+    vector<unsigned> listed;
+    unsigned round;
+    deque<int> open;
+
+    Isochrone()
+    {
+        round = 0;
+    }
+
+    void run(const Graph &g, const LineGraph &lg, int src, int kind, double budget, vector<pair<int, double>> &out)
+    {
+        out.clear();
+        if(kind == FARE)
+        {
+            cost.reset(g.n);
+            cost.label(src, 0, -1);
+            cost.settle(g, [&](int u)
+            {
+                if(cost.get(u) > budget) return true;
+                out.push_back({u, (double)cost.get(u)});
+                return false;
+            });
+            return;
+        }
+        if(kind == DISTANCE)
+        {
+            dist.reset(g.n);
+            dist.label(src, 0, -1);
+            dist.settle(g, [&](int u)
+            {
+                if(dist.get(u) > budget + 1e-9) return true;
+                out.push_back({u, dist.get(u)});
+                return false;
+            });
+            return;
+        }
+
+        if(labelled.size() != (size_t)lg.g.n || listed.size() != (size_t)g.n)
+        {
+            level.assign(lg.g.n, 0);
+            labelled.assign(lg.g.n, 0);
+            closed.assign(lg.g.n, 0);
+            listed.assign(g.n, 0);
+            round = 0;
+        }
+        if(++round == 0)
+        {
+            fill(labelled.begin(), labelled.end(), 0);
+            fill(closed.begin(), closed.end(), 0);
+            fill(listed.begin(), listed.end(), 0);
+            round = 1;
+        }
+
+        open.clear();
+        for(int x = lg.first[src]; x < lg.first[src + 1]; ++x)
+        {
+            level[x] = 0;
+            labelled[x] = round;
+            open.push_back(x);
+        }
+        while(!open.empty())
+        {
+            int u = open.front();
+            open.pop_front();
+            if(closed[u] == round) continue;
+            closed[u] = round;
+            if(level[u] > budget) break;
+
+            int st = lg.station[u];
+            if(listed[st] != round)
+            {
+                listed[st] = round;
+                out.push_back({st, (double)level[u]});
+            }
+            for(int e = lg.g.offset[u]; e < lg.g.offset[u + 1]; ++e)
+            {
+                int v = lg.g.target[e];
+                int change = lg.station[v] == st ? 1 : 0;
+                if(labelled[v] == round && level[v] <= level[u] + change) continue;
+                level[v] = level[u] + change;
+                labelled[v] = round;
+                if(change)
+                    open.push_back(v);
+                else
+                    open.push_front(v);
+            }
+        }
+    }
+};
+
+// Passenger loads from assigning an OD matrix: per directed arc of the station graph and per interchange station.
+class Assignment
+{
+public:
+    vector<double> arcLoad;
+    vector<double> transfers;
+    double assigned;
+    double unassigned;
+
+    void reset(const Graph &g)
+    {
+        arcLoad.assign(g.target.size(), 0);
+        transfers.assign(g.n, 0);
+        assigned = 0;
+        unassigned = 0;
+    }
+
+    void merge(const Assignment &x)
+    {
+        for(size_t e = 0; e < arcLoad.size(); ++e)
+        {
+            arcLoad[e] += x.arcLoad[e];
+        }
+        for(size_t v = 0; v < transfers.size(); ++v)
+        {
+            transfers[v] += x.transfers[v];
+        }
+        assigned += x.assigned;
+        unassigned += x.unassigned;
+    }
+};
+
+// Per-thread workspace. With one route per trip, a single line-graph tree from the origin serves every destination:
+// demand is dropped on each destination's best state and pushed up the tree in reverse settling order. With k routes,
+// trips are split evenly over the k loopless alternatives and interchanges are placed greedily.
+class DemandAssigner
+{
+    Dijkstra<int> cost;
+    Dijkstra<double> dist;
+    KShortest<int> costRoutes;
+    KShortest<double> distRoutes;
+    vector<int> order;
+    vector<double> flow;
+    vector<int> at;
+
+    template<class W>
+    void tree(const LineGraph &lg, const vector<int> &plainArc, Dijkstra<W> &search, int origin,
+              const vector<pair<int, double>> &trips, bool byCost, Assignment &out)
+    {
+        search.reset(lg.g.n);
+        for(int x = lg.first[origin]; x < lg.first[origin + 1]; ++x)
+        {
+            search.label(x, 0, -1);
+        }
+        order.clear();
+        search.settle(lg.g, [this](int u)
+        {
+            order.push_back(u);
+            return false;
+        });
+
+        if(flow.size() != (size_t)lg.g.n)
+            flow.assign(lg.g.n, 0);
+        for(const pair<int, double> &t : trips)
+        {
+            int best = -1;
+            for(int x = lg.first[t.first]; x < lg.first[t.first + 1]; ++x)
+            {
+                if(search.reached(x) && (best < 0 || search.get(x) < search.get(best)))
+                    best = x;
+            }
+            if(best < 0)
+            {
+                out.unassigned += t.second;
+                continue;
+            }
+            flow[best] += t.second;
+            out.assigned += t.second;
+        }
+
+        for(int i = (int)order.size() - 1; i >= 0; --i)
+        {
+            int v = order[i];
+            int p = search.parent[v];
+            double f = flow[v];
+            flow[v] = 0;
+            if(p < 0 || f == 0) continue;
+
+            int e = lg.g.findArc(p, v, byCost);
+            if(plainArc[e] >= 0)
+                out.arcLoad[plainArc[e]] += f;
+            else
+                out.transfers[lg.station[v]] += f;
+            flow[p] += f;
+        }
+    }
+
+    template<class W>
+    void split(const Graph &g, const LineGraph &lg, KShortest<W> &routes, int origin, const vector<pair<int, double>> &trips,
+               bool byCost, int k, Assignment &out)
+    {
+        for(const pair<int, double> &t : trips)
+        {
+            vector<pair<W, vector<int>>> found = routes.run(g, origin, t.first, k);
+            if(found.empty())
+            {
+                out.unassigned += t.second;
+                continue;
+            }
+            out.assigned += t.second;
+            double share = t.second / found.size();
+            for(const pair<W, vector<int>> &r : found)
+            {
+                const vector<int> &path = r.second;
+                for(int i = 1; i < (int)path.size(); ++i)
+                {
+                    out.arcLoad[g.findArc(path[i - 1], path[i], byCost)] += share;
+                }
+                at.clear();
+                lg.interchanges(path, &at);
+                for(int v : at)
+                {
+                    out.transfers[v] += share;
+                }
+            }
+        }
+    }
+
+public:
+    // plainArc maps each line-graph arc to the station-graph arc it rides, or -1 for a change of line.
+    static vector<int> plainArcs(const Graph &g, const LineGraph &lg, bool byCost)
+    {
+        vector<int> plainArc(lg.g.target.size(), -1);
+        for(int u = 0; u < lg.g.n; ++u)
+        {
+            for(int e = lg.g.offset[u]; e < lg.g.offset[u + 1]; ++e)
+            {
+                int a = lg.station[u];
+                int b = lg.station[lg.g.target[e]];
+                if(a != b)
+                    plainArc[e] = g.findArc(a, b, byCost);
+            }
+        }
+        return plainArc;
+    }
+
+    // With k = 1 every trip rides its best route on the line graph, so interchange penalties shape the route. With k > 1
+    // the k routes come from Yen's algorithm on the station graph, because on the line graph most of the k would be
+    // one station path on different lines. They are ranked without interchange penalties, and each route's
+    // interchanges are counted afterwards.
+    void assign(const Graph &g, const LineGraph &lg, const vector<int> &plainArc, int origin, const vector<pair<int, double>> &trips,
+                bool byCost, int k, Assignment &out)
+    {
+        if(k > 1 && byCost)
+            split(g, lg, costRoutes, origin, trips, byCost, k, out);
+        else if(k > 1)
+            split(g, lg, distRoutes, origin, trips, byCost, k, out);
+        else if(byCost)
+            tree(lg, plainArc, cost, origin, trips, byCost, out);
+        else
+            tree(lg, plainArc, dist, origin, trips, byCost, out);
+    }
+};
+
+// Brandes' betweenness for one criterion. Each thread owns one, reusing its per-source buffers and summing the
+// dependencies of every source it runs into station and arc totals that are merged once at the end.
+template<class W>
+class Brandes
+{
+public:
+    vector<W> dist;
+    vector<double> sigma;
+    vector<double> delta;
+    vector<int> pos;
+    vector<int> order;
+    typename QueueFor<W>::type heap;
+    vector<double> station;
+    vector<double> arc;
+
+    void reset(const Graph &g)
+    {
+        station.assign(g.n, 0);
+        arc.assign(g.target.size(), 0);
+    }
+
+    // Distances this close count as the same, so fares compare exactly and distances within rounding.
+    static bool tied(W a, W b)
+    {
+        return a <= b + (W)1e-9 && b <= a + (W)1e-9;
+    }
+
+    // sigma counts the shortest paths from src; walking back in settle order, a station earlier on a tied arc is
+    // a predecessor and takes its share of the dependency.
+    void run(const Graph &g, int src)
+    {
+        const vector<W> &weight = g.weights(W());
+        const W INF = numeric_limits<W>::max();
+        dist.assign(g.n, INF);
+        sigma.assign(g.n, 0);
+        delta.assign(g.n, 0);
+        pos.assign(g.n, -1);
+        order.clear();
+        heap.clear();
+
+        dist[src] = 0;
+        sigma[src] = 1;
+        heap.push(0, src);
+        while(!heap.empty())
+        {
+            pair<W, int> x = heap.pop();
+            int u = x.second;
+            if(pos[u] >= 0 || x.first > dist[u]) continue;
+
+            pos[u] = order.size();
+            order.push_back(u);
+            for(int e = g.offset[u]; e < g.offset[u + 1]; ++e)
+            {
+                int v = g.target[e];
+                W nd = dist[u] + weight[e];
+                if(pos[v] >= 0) continue;
+                if(dist[v] != INF && tied(nd, dist[v]))
+                    sigma[v] += sigma[u];
+                else if(nd < dist[v])
+                {
+                    dist[v] = nd;
+                    sigma[v] = sigma[u];
+                    heap.push(nd, v);
+                }
+            }
+        }
+
+        for(int i = order.size() - 1; i > 0; --i)
+        {
+            int w = order[i];
+            double share = (1 + delta[w]) / sigma[w];
+            for(int e = g.offset[w]; e < g.offset[w + 1]; ++e)
+            {
+                int v = g.target[e];
+                if(pos[v] < 0 || pos[v] >= pos[w] || !tied(dist[v] + weight[e], dist[w])) continue;
+                double c = sigma[v] * share;
+                delta[v] += c;
+                arc[e] += c;
+            }
+            station[w] += delta[w];
+        }
+    }
+
+    void merge(const Brandes &other)
+    {
+        for(size_t v = 0; v < station.size(); ++v)
+        {
+            station[v] += other.station[v];
+        }
+        for(size_t e = 0; e < arc.size(); ++e)
+        {
+            arc[e] += other.arc[e];
+        }
+    }
+};
+
+// Pairs of stations whose best route got longer or was cut by a set of closures. Only sources whose shortest-path
+// trees ran through a closed element are searched again.
+template<class W>
+class Disruption
+{
+public:
+    class Change
+    {
+    public:
+        int from;
+        int to;
+        W before;
+        W after;
+    };
+
+    vector<Change> changes;
+    int recomputed;
+
+    Disruption()
+    {
+        recomputed = 0;
+    }
+
+    static bool tied(W a, W b)
+    {
+        return a <= b + (W)1e-9 && b <= a + (W)1e-9;
+    }
+
+    // An arc x -> y carries routes from s when d(s, x) + w = d(s, y). The closed arcs are those of closed segments
+    // and those leaving closed stations, and as the network is symmetric one search from each end gives d(s, .) for
+    // every s at once.
+    void run(const Graph &before, const Graph &after, const vector<int> &stations, const vector<pair<int, int>> &segments, int threads)
+    {
+        const vector<W> &weight = before.weights(W());
+        const W INF = Dijkstra<W>::infinity();
+        vector<char> closed(before.n, 0);
+        vector<pair<int, int>> arcs;
+        for(int v : stations)
+        {
+            closed[v] = 1;
+            for(int e = before.offset[v]; e < before.offset[v + 1]; ++e)
+            {
+                arcs.push_back({v, e});
+            }
+        }
+        for(const pair<int, int> &x : segments)
+        {
+            for(int u : {x.first, x.second})
+            {
+                for(int e = before.offset[u]; e < before.offset[u + 1]; ++e)
+                {
+                    if(before.target[e] == x.first + x.second - u)
+                        arcs.push_back({u, e});
+                }
+            }
+        }
+
+        vector<int> ends;
+        for(const pair<int, int> &x : arcs)
+        {
+            ends.push_back(x.first);
+            ends.push_back(before.target[x.second]);
+        }
+        sort(ends.begin(), ends.end());
+        ends.erase(unique(ends.begin(), ends.end()), ends.end());
+
+        ThreadPool pool(threads);
+        vector<vector<W>> from(ends.size(), vector<W>(before.n, INF));
+        vector<Dijkstra<W>> pre(pool.size()), post(pool.size());
+        pool.parallelFor(ends.size(), 1, [&](int w, size_t b, size_t e)
+        {
+            for(size_t i = b; i < e; ++i)
+            {
+                pre[w].run(before, ends[i], -1);
+                for(int v = 0; v < before.n; ++v)
+                {
+                    from[i][v] = pre[w].get(v);
+                }
+            }
+        });
+        auto at = [&ends](int v) { return lower_bound(ends.begin(), ends.end(), v) - ends.begin(); };
+
+        vector<char> affected(before.n, 0);
+        vector<int> sources;
+        for(int src = 0; src < before.n; ++src)
+        {
+            for(const pair<int, int> &x : arcs)
+            {
+                W dx = from[at(x.first)][src];
+                W dy = from[at(before.target[x.second])][src];
+                if(!closed[src] && dx != INF && dy != INF && tied(dx + weight[x.second], dy))
+                {
+                    affected[src] = 1;
+                    sources.push_back(src);
+                    break;
+                }
+            }
+        }
+
+        vector<vector<Change>> found(pool.size());
+        pool.parallelFor(sources.size(), 1, [&](int w, size_t b, size_t e)
+        {
+            for(size_t i = b; i < e; ++i)
+            {
+                int src = sources[i];
+                pre[w].run(before, src, -1);
+                post[w].run(after, src, -1);
+                for(int t = 0; t < before.n; ++t)
+                {
+                    if(t == src || closed[t] || (affected[t] && t < src) || !pre[w].reached(t)) continue;
+                    W d0 = pre[w].get(t);
+                    W d1 = post[w].get(t);
+                    if(d1 == INF || (d1 > d0 && !tied(d0, d1)))
+                        found[w].push_back({min(src, t), max(src, t), d0, d1});
+                }
+            }
+        });
+
+        changes.clear();
+        for(const vector<Change> &x : found)
+        {
+            changes.insert(changes.end(), x.begin(), x.end());
+        }
+        sort(changes.begin(), changes.end(), [](const Change &a, const Change &b)
+        {
+            return a.from != b.from ? a.from < b.from : a.to < b.to;
+        });
+        recomputed = sources.size();
+    }
+};
+
+// Everything a query reads, frozen when it was published. Readers never see a version change under them; only the
+// cache, which locks its own shards, is written after publication.
+class NetworkVersion
+{
+public:
+    uint64_t number;
+    int stations;
+    Stations names;
+    Graph net;
+    LineGraph states;
+    GeoBound geo;
+    Hierarchy hierarchy;
+    const RouteTable *table;
+    const HubLabels *hubs;
+    const Hierarchy *ch;
+    mutable RouteCache cache;
+
+    NetworkVersion()
+    {
+        number = 0;
+        stations = 0;
+        table = NULL;
+        hubs = NULL;
+        ch = NULL;
+    }
+
+    int resolve(const string &name) const
+    {
+        return resolveStation(name, names, stations);
+    }
+};
+
+// Epoch-based reclamation for network versions. A reader announces the epoch it entered in its own slot before
+// loading the current version, so a version retired at epoch e is freed once every busy slot is past e. Readers
+// never wait; writers take the writer lock around an edit and its publish.
+class EpochDomain
+{
+public:
+    static constexpr int SLOTS = 256;
+
+    class alignas(64) Slot
+    {
+    public:
+        atomic<uint64_t> epoch;
+    };
+
+    atomic<const NetworkVersion*> current;
+    atomic<uint64_t> epoch;
+    atomic<int> joined;
+    Slot slot[SLOTS];
+    mutex writer;
+    vector<pair<uint64_t, const NetworkVersion*>> retired;
+
+    EpochDomain()
+    {
+        current = NULL;
+        epoch = 1;
+        joined = 0;
+        for(Slot &x : slot)
+        {
+            x.epoch = 0;
+        }
+    }
+
+    ~EpochDomain()
+    {
+        for(pair<uint64_t, const NetworkVersion*> &x : retired)
+        {
+            delete x.second;
+        }
+        delete current.load();
+    }
+
+    // Returns a slot for the calling thread, or -1 once all are taken.
+    int join()
+    {
+        int k = joined++;
+        return k < SLOTS ? k : -1;
+    }
+
+    const NetworkVersion *pin(int k)
+    {
+        slot[k].epoch = epoch.load();
+        return current.load();
+    }
+
+    void unpin(int k)
+    {
+        slot[k].epoch = 0;
+    }
+
+    // Caller holds writer.
+    void publish(const NetworkVersion *v)
+    {
+        const NetworkVersion *old = current.exchange(v);
+        uint64_t e = epoch++;
+        if(old)
+            retired.push_back({e, old});
+
+        uint64_t oldest = UINT64_MAX;
+        for(Slot &x : slot)
+        {
+            uint64_t busy = x.epoch;
+            if(busy)
+                oldest = min(oldest, busy);
+        }
+        size_t kept = 0;
+        for(pair<uint64_t, const NetworkVersion*> &x : retired)
+        {
+            if(x.first < oldest)
+                delete x.second;
+            else
+                retired[kept++] = x;
+        }
+        retired.resize(kept);
+    }
+};
+
+class Lines
+{
+    vector<Segment> segments;
+    vector<Segment> active;
+    vector<char> closedStation;
+    unordered_set<uint64_t> closedSegment;
+    Graph g;
+    bool dirty;
+    uint64_t fp;
+    LineGraph lg;
+    bool lgDirty;
+    GeoBound geo;
+    RouteWorker worker;
+    vector<Segment> lowered;
+    bool raised;
+    ParetoSearch pareto;
+    KShortest<int> costAlternatives;
+    KShortest<double> distAlternatives;
+    Timetable tt;
+    bool ttDirty;
+    bool chDirty;
+    bool tablePinned;
+    uint64_t published;
+    Raptor raptor;
+    Isochrone iso;
+
+public:
+    RouteTable table;
+    HubLabels hubs;
+    Hierarchy ch;
+    RouteCache cache;
+    bool lineAware;
+    bool guided;
+    int transferCost;
+    double transferDistance;
+
+    Lines()
+    {
+        dirty = true;
+        fp = 0;
+        raised = false;
+        lgDirty = true;
+        ttDirty = true;
+        chDirty = true;
+        tablePinned = false;
+        published = 0;
+        lineAware = false;
+        guided = false;
+        transferCost = 5;
+        transferDistance = 0.5;
+    }
+
+    bool addLine(string a, string b, int c, double d)
+    {
+        int x = m.getId(a);
+        int y = m.getId(b);
+        if(x < 0 || y < 0)
+            return false;
+
+        addSegment(x, y, c, d);
+        return true;
+    }
+
+    void addSegment(int x, int y, int c, double d)
+    {
+        segments.push_back(Segment(x, y, c, d));
+        lowered.push_back(segments.back());
+        dirty = true;
+        if(cache.size())
+            invalidate(x, y);
+    }
+
+    // Returns false if x and y are not directly connected.
+    bool repriceSegment(int x, int y, int c, double d)
+    {
+        bool found = false;
+        bool cheaper = true;
+        for(Segment &e : segments)
+        {
+            if(!((e.a == x && e.b == y) || (e.a == y && e.b == x))) continue;
+            cheaper = cheaper && c <= e.cost && d <= e.distance;
+            e.cost = c;
+            e.distance = d;
+            found = true;
+        }
+        if(!found)
+            return false;
+
+        dirty = true;
+        if(cheaper)
+        {
+            lowered.push_back(Segment(x, y, c, d));
+            if(cache.size())
+                invalidate(x, y);
+            return true;
+        }
+
+        raised = true;
+        cache.removeIf([x, y](int, int, int, double, const RouteResult &r)
+        {
+            for(int i = 1; i < (int)r.path.size(); ++i)
+            {
+                if((r.path[i - 1] == x && r.path[i] == y) || (r.path[i - 1] == y && r.path[i] == x))
+                    return true;
+            }
+            return false;
+        });
+        return true;
+    }
+
+    // A cached route can only improve through the new segment x-y, so it is dropped only if
+    // travelling via x-y now beats its stored value; penalties are never negative, so raw bounds also cover line-aware entries.
+    // A closed segment or station leaves x-y out of the graph, and then no route can use it yet.
+    void invalidate(int x, int y)
+    {
+        const Graph &net = graph();
+        int costArc = net.findArc(x, y, true);
+        int distArc = net.findArc(x, y, false);
+        if(costArc < 0 || distArc < 0)
+            return;
+
+        Dijkstra<int> cx, cy;
+        Dijkstra<double> dx, dy;
+        cx.run(net, x, -1);
+        cy.run(net, y, -1);
+        dx.run(net, x, -1);
+        dy.run(net, y, -1);
+
+        cache.removeIf([&](int from, int to, int criterion, double value, const RouteResult &)
+        {
+            if(criterion & 1)
+            {
+                long long bound = LLONG_MAX;
+                if(cx.reached(from) && cy.reached(to))
+                    bound = min(bound, (long long)cx.get(from) + cy.get(to));
+                if(cy.reached(from) && cx.reached(to))
+                    bound = min(bound, (long long)cy.get(from) + cx.get(to));
+                return bound != LLONG_MAX && bound + net.cost[costArc] < value;
+            }
+            double bound = min(dx.get(from) + dy.get(to), dy.get(from) + dx.get(to));
+            return bound + net.distance[distArc] < value - 1e-9;
+        });
+    }
+
+    const vector<Segment> &allSegments() const
+    {
+        return segments;
+    }
+
+    static uint64_t pairKey(int x, int y)
+    {
+        return (uint64_t)min(x, y) << 32 | max(x, y);
+    }
+
+    bool stationClosed(int v) const
+    {
+        return v < (int)closedStation.size() && closedStation[v];
+    }
+
+    bool isOpen(const Segment &e) const
+    {
+        return !stationClosed(e.a) && !stationClosed(e.b) && !closedSegment.count(pairKey(e.a, e.b));
+    }
+
+    // Closed stations and segments stay in the network but are left out of the graph every route is searched on.
+    // Closing drops cached routes through the element; reopening can shorten any route, so it drops them all. The
+    // route table is never patched for either, and matches again once everything it was built with has reopened.
+    void setStationClosed(int v, bool closed)
+    {
+        if(stationClosed(v) == closed)
+            return;
+        if(v >= (int)closedStation.size())
+            closedStation.resize(v + 1, 0);
+        closedStation[v] = closed;
+        reopenOrClose(closed, [v](const RouteResult &r) { return find(r.path.begin(), r.path.end(), v) != r.path.end(); });
+    }
+
+    // Returns false if x and y are not directly connected.
+    bool setSegmentClosed(int x, int y, bool closed)
+    {
+        bool found = false;
+        for(const Segment &e : segments)
+        {
+            found = found || (e.a == x && e.b == y) || (e.a == y && e.b == x);
+        }
+        if(!found)
+            return false;
+        if(closedSegment.count(pairKey(x, y)) == (size_t)closed)
+            return true;
+
+        if(closed)
+            closedSegment.insert(pairKey(x, y));
+        else
+            closedSegment.erase(pairKey(x, y));
+        reopenOrClose(closed, [x, y](const RouteResult &r)
+        {
+            for(int i = 1; i < (int)r.path.size(); ++i)
+            {
+                if(pairKey(r.path[i - 1], r.path[i]) == pairKey(x, y))
+                    return true;
+            }
+            return false;
+        });
+        return true;
+    }
+
+    template<class Uses>
+    void reopenOrClose(bool closed, Uses uses)
+    {
+        dirty = true;
+        raised = true;
+        cache.removeIf([closed, &uses](int, int, int, double, const RouteResult &r) { return !closed || uses(r); });
+    }
+
+    void reopenAll()
+    {
+        for(int v : closedStations())
+        {
+            setStationClosed(v, false);
+        }
+        for(const pair<int, int> &x : closedSegments())
+        {
+            setSegmentClosed(x.first, x.second, false);
+        }
+    }
+
+    vector<int> closedStations() const
+    {
+        vector<int> out;
+        for(int v = 0; v < (int)closedStation.size(); ++v)
+        {
+            if(closedStation[v])
+                out.push_back(v);
+        }
+        return out;
+    }
+
+    vector<pair<int, int>> closedSegments() const
+    {
+        vector<pair<int, int>> out;
+        for(uint64_t k : closedSegment)
+        {
+            out.push_back({(int)(k >> 32), (int)(k & 0xFFFFFFFFULL)});
+        }
+        sort(out.begin(), out.end());
+        return out;
+    }
+
+    const Graph &graph()
+    {
+        if(dirty || g.n != stationIdUsed + 1)
+        {
+            bool live = table.matches(g.n, fp) && !raised && !tablePinned;
+            active.clear();
+            for(const Segment &e : segments)
+            {
+                if(isOpen(e))
+                    active.push_back(e);
+            }
+            g.build(stationIdUsed + 1, active);
+            fp = computeFingerprint();
+            if(live)
+            {
+                table.grow(g.n);
+                for(const Segment &e : lowered)
+                {
+                    if(isOpen(e))
+                        table.insertEdge(e.a, e.b, e.cost, e.distance);
+                }
+                table.fingerprint = fp;
+            }
+            lowered.clear();
+            raised = false;
+            dirty = false;
+            lgDirty = true;
+            chDirty = true;
+            geo.build(g);
+        }
+        return g;
+    }
+
+    const GeoBound &bound()
+    {
+        graph();
+        return geo;
+    }
+
+    const LineGraph &lineGraph()
+    {
+        graph();
+        if(lgDirty)
+        {
+            lg.build(g.n, active, transferCost, transferDistance);
+            lgDirty = false;
+            ttDirty = true;
+        }
+        return lg;
+    }
+
+    const Timetable &timetable()
+    {
+        lineGraph();
+        if(ttDirty)
+        {
+            tt.build(lg);
+            ttDirty = false;
+        }
+        return tt;
+    }
+
+    bool loadTimetable(const string &path)
+    {
+        ttDirty = true;
+        return tt.loadConfig(path);
+    }
+
+    void setTransferPenalty(int cost, double distance)
+    {
+        transferCost = cost;
+        transferDistance = distance;
+        lgDirty = true;
+        cache.removeIf([](int, int, int criterion, double, const RouteResult &) { return (criterion & 2) != 0; });
+    }
+
+    uint64_t computeFingerprint()
+    {
+        uint64_t h = 1469598103934665603ULL;
+        auto mix = [&h](const void *p, size_t len)
+        {
+            for(size_t i = 0; i < len; ++i)
+            {
+                h ^= ((const unsigned char*)p)[i];
+                h *= 1099511628211ULL;
+            }
+        };
+
+        for(int i = 0; i <= stationIdUsed; ++i)
+        {
+            mix(m.stationFromId[i].data(), m.stationFromId[i].size());
+            mix("", 1);
+        }
+        for(const Segment &e : active)
+        {
+            mix(&e.a, sizeof(e.a));
+            mix(&e.b, sizeof(e.b));
+            mix(&e.cost, sizeof(e.cost));
+            mix(&e.distance, sizeof(e.distance));
+        }
+        return h;
+    }
+
+    uint64_t fingerprint()
+    {
+        graph();
+        return fp;
+    }
+
+    bool useTable()
+    {
+        int n = graph().n;
+        return table.matches(n, fp);
+    }
+
+    bool useHubs()
+    {
+        int n = graph().n;
+        return hubs.matches(n, fp);
+    }
+
+    // Re-customises after any change to the network; false if the saved order no longer covers every segment.
+    bool useHierarchy()
+    {
+        graph();
+        if(chDirty)
+        {
+            ch.customise(g);
+            chDirty = false;
+        }
+        return ch.customised;
+    }
+
+    bool loadHierarchy(const string &path)
+    {
+        chDirty = true;
+        return ch.load(path);
+    }
+
+    // Copies the current network into a new version. Once a version points at the route table, later edits leave the
+    // table alone rather than updating it under readers.
+    NetworkVersion *snapshot()
+    {
+        NetworkVersion *v = new NetworkVersion();
+        v->number = ++published;
+        v->stations = stationIdUsed + 1;
+        v->names = s;
+        v->net = graph();
+        v->states = lineGraph();
+        v->geo = bound();
+        if(useTable())
+        {
+            v->table = &table;
+            tablePinned = true;
+        }
+        v->hubs = useHubs() ? &hubs : NULL;
+        if(useHierarchy())
+        {
+            v->hierarchy = ch;
+            v->ch = &v->hierarchy;
+        }
+        v->cache.setCapacity(cache.perShard * RouteCache::SHARDS);
+        return v;
+    }
+
+    void displayNetwork()
+    {
+        system("cls");
+        cout << "NETWORK CONNECTION OF ALL STATIONS" << endl << endl;
+
+        const Graph &net = graph();
+        for(int u = 0; u < net.n; ++u)
+        {
+            if(net.offset[u] == net.offset[u + 1]) continue;
+
+            cout << "Station '" << m.stationFromId[u] << "' is connected to ->" << endl;
+            for(int e = net.offset[u]; e < net.offset[u + 1]; ++e)
+            {
+                cout << "     " << m.stationFromId[net.target[e]] << " by cost " << net.cost[e] << " and distance " << net.distance[e] << endl;
+            }
+            cout << endl;
+        }
+
+        cout << endl;
+        cout << "Press any key to go back... ";
+        getch();
+        system("cls");
+    }
+
+    void printJourney(const vector<int> &path)
+    {
+        int current = path.size() > 1 ? LineColors::lowest(c.lines(path[0]) & c.lines(path[1])) : -1;
+        cout << endl << " > Start with " << (current < 0 ? "" : c.names[current]) << " colour line" << endl;
+        cout << m.stationFromId[path[0]];
+
+        for(int i = 1; i < (int)path.size(); ++i)
+        {
+            if(current >= 0 && (c.lines(path[i]) >> current & 1))
+            {
+                cout << "->" << m.stationFromId[path[i]];
+            }
+            else
+            {
+                int next = LineColors::lowest(c.lines(path[i - 1]) & c.lines(path[i]));
+                if(next >= 0)
+                    current = next;
+                cout << endl << endl << " > Switch to " << (current < 0 ? "" : c.names[current]) << " color line" << endl;
+                cout << m.stationFromId[path[i]];
+            }
+        }
+    }
+
+    void printItinerary(const vector<int> &states, bool byCost)
+    {
+        const LineGraph &net = lineGraph();
+        int k = 0;
+        while(k + 1 < (int)states.size() && net.station[states[k]] == net.station[states[k + 1]])
+        {
+            ++k;
+        }
+
+        int cost, interchanges;
+        double distance;
+        net.measure(states, byCost, cost, distance, interchanges);
+        bool switched = false;
+
+        cout << endl << " > Start with " << net.lineName(states[k]) << " colour line" << endl;
+        cout << m.stationFromId[net.station[states[k]]];
+
+        for(int i = k + 1; i < (int)states.size(); ++i)
+        {
+            int u = states[i - 1];
+            int v = states[i];
+
+            if(net.station[u] == net.station[v])
+            {
+                switched = true;
+                cout << endl << endl << " > Switch to " << net.lineName(v) << " color line" << endl;
+            }
+            else
+            {
+                if(!switched && (net.line[u] != net.line[v] || net.line[v] < 0))
+                    cout << endl << endl << " > Continue on " << net.lineName(v) << " color line" << endl;
+                else if(!switched)
+                    cout << "->";
+                cout << m.stationFromId[net.station[v]];
+                switched = false;
+            }
+        }
+
+        cout << endl << endl << "*** Total cost of journey will be rupees " << cost << " ***" << endl;
+        cout << "*** Total Distance of journey will be " << distance << " kms ***" << endl;
+        cout << "*** Number of interchanges: " << interchanges << " ***" << endl << endl << endl;
+    }
+
+    void allRoutes(string src, string dest)
+    {
+        int from = m.getId(src);
+        int to = m.getId(dest);
+        vector<int> found;
+        if(from >= 0 && to >= 0)
+            found = pareto.run(graph(), lineGraph(), from, to);
+
+        if(found.empty())
+        {
+            cout << endl << " > No route found from " << src << " to " << dest << endl << endl;
+            return;
+        }
+
+        cout << "ROUTE OPTIONS FROM '" << src << "' TO '" << dest << "'" << endl;
+        for(int i = 0; i < (int)found.size(); ++i)
+        {
+            const ParetoLabel &x = pareto.labels[found[i]];
+            cout << endl << "Option " << i + 1 << ": rupees " << x.cost << ", " << x.distance << " kms, " << x.transfers << " interchanges" << endl;
+            printItinerary(pareto.path(found[i]), true);
+        }
+    }
+
+    void alternativeRoutes(string src, string dest, int k, bool byCost)
+    {
+        int from = m.getId(src);
+        int to = m.getId(dest);
+        vector<pair<int, vector<int>>> byFare;
+        vector<pair<double, vector<int>>> byDistance;
+        if(from >= 0 && to >= 0 && byCost)
+            byFare = costAlternatives.run(graph(), from, to, k);
+        else if(from >= 0 && to >= 0)
+            byDistance = distAlternatives.run(graph(), from, to, k);
+
+        if(byFare.empty() && byDistance.empty())
+        {
+            cout << endl << " > No route found from " << src << " to " << dest << endl << endl;
+            return;
+        }
+
+        cout << "ALTERNATIVE ROUTES FROM '" << src << "' TO '" << dest << "' BY " << (byCost ? "COST" : "DISTANCE") << endl;
+        for(int i = 0; i < (int)max(byFare.size(), byDistance.size()); ++i)
+        {
+            cout << endl << "Route " << i + 1 << ": ";
+            if(byCost)
+                cout << "rupees " << byFare[i].first << endl;
+            else
+                cout << byDistance[i].first << " kms" << endl;
+            printJourney(byCost ? byFare[i].second : byDistance[i].second);
+            cout << endl;
+        }
+    }
+
+    void reachable(string src, int kind, double budget)
+    {
+        int from = m.getId(src);
+        vector<pair<int, double>> found;
+        if(from >= 0)
+            iso.run(graph(), lineGraph(), from, kind, budget, found);
+
+        const char *unit = kind == Isochrone::FARE ? "rupees" : kind == Isochrone::DISTANCE ? "kms" : "interchanges";
+        cout << "STATIONS WITHIN " << budget << " " << unit << " OF '" << src << "'" << endl << endl;
+        for(const pair<int, double> &x : found)
+        {
+            if(x.first == from) continue;
+            cout << " " << x.second << " " << unit << "\t" << m.stationFromId[x.first] << endl;
+        }
+        cout << endl << " > " << (found.empty() ? 0 : found.size() - 1) << " stations reachable" << endl;
+    }
+
+    void printLegs(const vector<TimetableLeg> &legs)
+    {
+        const Timetable &net = timetable();
+        for(int i = 0; i < (int)legs.size(); ++i)
+        {
+            const TimetableLeg &x = legs[i];
+            const int *path = &net.stops[net.stopOffset[x.route]];
+            cout << (i == 0 ? " > Leave " : " > Change at ") << m.stationFromId[path[x.board]] << " at " << clockText(net.departure(x.route, x.trip, x.board));
+            cout << " on " << lg.lineNames[net.routeLine[x.route]] << " line towards " << m.stationFromId[path[net.size(x.route) - 1]] << endl;
+            cout << "   Alight at " << m.stationFromId[path[x.alight]] << " at " << clockText(net.arrival(x.route, x.trip, x.alight)) << endl;
+        }
+    }
+
+    void timedRoute(string src, string dest, int start, int end)
+    {
+        int from = m.getId(src);
+        int to = m.getId(dest);
+        const Timetable &net = timetable();
+
+        if(from >= 0 && from == to)
+        {
+            cout << endl << " > You are already at " << src << endl << endl;
+            return;
+        }
+
+        vector<pair<int, vector<TimetableLeg>>> options;
+        if(from >= 0 && to >= 0 && end < 0)
+        {
+            vector<TimetableLeg> legs = raptor.earliestArrival(net, from, to, start);
+            if(legs.size())
+                options.push_back({start, legs});
+        }
+        else if(from >= 0 && to >= 0)
+        {
+            options = raptor.profile(net, from, to, start, end);
+        }
+
+        if(options.empty())
+        {
+            cout << endl << " > No train service from " << src << " to " << dest << " in that time" << endl << endl;
+            return;
+        }
+
+        for(auto &x : options)
+        {
+            const TimetableLeg &last = x.second.back();
+            cout << endl << "Depart " << clockText(net.departure(x.second[0].route, x.second[0].trip, x.second[0].board));
+            cout << ", arrive " << clockText(net.arrival(last.route, last.trip, last.alight)) << ", " << x.second.size() - 1 << " interchanges" << endl;
+            printLegs(x.second);
+        }
+        cout << endl;
+    }
+
+    void route(string src, string dest, bool byCost)
+    {
+        int from = m.getId(src);
+        int to = m.getId(dest);
+        RouteResult r;
+
+        if(from < 0 || to < 0 || !findRoute(graph(), lineGraph(), useTable() ? &table : NULL, useHubs() ? &hubs : NULL, useHierarchy() ? &ch : NULL, guided ? &bound() : NULL, worker, from, to, byCost, lineAware, r, &cache))
+        {
+            cout << endl << " > No route found from " << src << " to " << dest << endl << endl;
+            return;
+        }
+
+        auto printing = chrono::steady_clock::now();
+        if(lineAware)
+            printItinerary(r.states, byCost);
+        else
+        {
+            printJourney(r.path);
+            if(byCost)
+                cout << endl << endl << "*** Total cost of journey will be rupees " << r.cost << " ***" << endl << endl << endl;
+            else
+                cout << endl << endl << "*** Total Distance of journey will be " << r.distance << " kms ***" << endl << endl << endl;
+        }
+        if(metrics.enabled)
+            metrics.time(QueryMetrics::PRINT, printing);
+    }
+
+    void cheapestRoute(string src, string dest)
+    {
+        route(src, dest, true);
+    }
+
+    void ShortestRoute(string src, string dest)
+    {
+        route(src, dest, false);
+    }
+};
+
+Lines l;
+EpochDomain versions;
+
+const char *delhiNetwork = R"(
+# Delhi Metro network: "station <name> | <lines> [| <lat> | <lon>]" and "segment <a> | <b> | <cost> | <kms>"
+station welcome | Red | 28.6719 | 77.2777
+station seelampur | Red | 28.6700 | 77.2668
+station shastri park | Red | 28.6683 | 77.2503
+station kashmere gate | Red, Yellow, Violet | 28.6675 | 77.2282
+station tis hazari | Red | 28.6671 | 77.2167
+station pulbangash | Red | 28.6664 | 77.2069
+station pratap nagar | Red | 28.6666 | 77.1983
+station shastri nagar | Red | 28.6700 | 77.1816
+station inderlok | Green, Red | 28.6735 | 77.1701
+station kanhaiya nagar | Red | 28.6825 | 77.1645
+station keshav puram | Red | 28.6889 | 77.1618
+station netaji subhash place | Red | 28.6961 | 77.1524
+station rithala | Red | 28.7208 | 77.1072
+station madipur | Green | 28.6682 | 77.1325
+station shivaji park | Green | 28.6702 | 77.1392
+station punjabi bagh | Green | 28.6726 | 77.1461
+station ashok park | Green | 28.6717 | 77.1553
+station sat guru ram singh marg | Green | 28.6628 | 77.1576
+station kirti nagar | Green, Blue | 28.6555 | 77.1505
+station shadipur | Blue | 28.6516 | 77.1583
+station patel nagar | Blue | 28.6450 | 77.1690
+station rajender place | Blue | 28.6424 | 77.1784
+station karol bagh | Blue | 28.6440 | 77.1885
+station rajiv chowk | Blue, Yellow | 28.6328 | 77.2197
+station barakhamba road | Blue | 28.6298 | 77.2244
+station mandi house | Blue, Violet | 28.6258 | 77.2341
+station pragati maiden | Blue | 28.6233 | 77.2426
+station inderprastha | Blue | 28.6204 | 77.2497
+station yamuna bank | Blue | 28.6232 | 77.2678
+station vishwavidalaya | Yellow | 28.6950 | 77.2148
+station vidhan sabha | Yellow | 28.6881 | 77.2214
+station civil lines | Yellow | 28.6768 | 77.2250
+station chandni chowk | Yellow | 28.6579 | 77.2300
+station chawri bazar | Yellow | 28.6493 | 77.2263
+station new delhi | Yellow | 28.6430 | 77.2221
+station patel chowk | Yellow | 28.6229 | 77.2141
+station central secretariat | Yellow, Violet | 28.6147 | 77.2119
+station udyog bhawan | Yellow | 28.6113 | 77.2120
+station lok kalyan marg | Yellow | 28.5976 | 77.2104
+station jor bagh | Yellow | 28.5873 | 77.2123
+station lal qila | Violet | 28.6564 | 77.2410
+station jama masjid | Violet | 28.6505 | 77.2377
+station delhi gate | Violet | 28.6406 | 77.2405
+station ito | Violet | 28.6275 | 77.2411
+station janptah | Violet | 28.6243 | 77.2192
+station khan market | Violet | 28.6001 | 77.2275
+station jl nehru stadium | Violet | 28.5903 | 77.2335
+station jangpura | Violet | 28.5840 | 77.2380
+station rajouri garden | Blue | 28.6490 | 77.1226
+station ramesh nagar | Blue | 28.6527 | 77.1318
+station moti nagar | Blue | 28.6578 | 77.1425
+segment rithala | netaji subhash place | 30 | 5.2
+segment netaji subhash place | keshav puram | 10 | 1.2
+segment keshav puram | kanhaiya nagar | 10 | 0.8
+segment kanhaiya nagar | inderlok | 10 | 1.2
+segment madipur | shivaji park | 10 | 1.1
+segment shivaji park | punjabi bagh | 10 | 1.6
+segment punjabi bagh | ashok park | 10 | 0.9
+segment ashok park | sat guru ram singh marg | 10 | 1.1
+segment ashok park | inderlok | 10 | 1.4
+segment rajouri garden | ramesh nagar | 10 | 1
+segment ramesh nagar | moti nagar | 10 | 1.2
+segment inderlok | shastri nagar | 10 | 1.2
+segment moti nagar | kirti nagar | 10 | 1
+segment sat guru ram singh marg | kirti nagar | 10 | 1
+segment shastri nagar | pratap nagar | 10 | 1.7
+segment kirti nagar | shadipur | 10 | 0.7
+segment pratap nagar | pulbangash | 10 | 0.8
+segment vishwavidalaya | vidhan sabha | 10 | 1
+segment shadipur | patel nagar | 10 | 1.3
+segment pulbangash | tis hazari | 10 | 0.9
+segment vidhan sabha | civil lines | 10 | 1.3
+segment patel nagar | rajender place | 10 | 0.9
+segment tis hazari | kashmere gate | 10 | 1.1
+segment civil lines | kashmere gate | 10 | 1.1
+segment rajender place | karol bagh | 10 | 1
+segment kashmere gate | shastri park | 20 | 2.2
+segment kashmere gate | lal qila | 10 | 1.5
+segment kashmere gate | chandni chowk | 10 | 1.1
+segment shastri park | seelampur | 10 | 1.6
+segment lal qila | jama masjid | 10 | 0.8
+segment chandni chowk | chawri bazar | 10 | 1
+segment seelampur | welcome | 10 | 1.1
+segment jama masjid | delhi gate | 10 | 1.4
+segment chawri bazar | new delhi | 10 | 0.8
+segment karol bagh | rajiv chowk | 20 | 3.4
+segment new delhi | rajiv chowk | 10 | 1.1
+segment delhi gate | ito | 10 | 1.3
+segment rajiv chowk | barakhamba road | 10 | 0.7
+segment rajiv chowk | patel chowk | 10 | 1.3
+segment ito | mandi house | 10 | 0.8
+segment barakhamba road | mandi house | 10 | 1
+segment mandi house | pragati maiden | 10 | 0.8
+segment mandi house | janptah | 10 | 1.4
+segment inderprastha | pragati maiden | 10 | 0.8
+segment janptah | central secretariat | 10 | 1.3
+segment patel chowk | central secretariat | 10 | 0.9
+segment inderprastha | yamuna bank | 10 | 1.8
+segment central secretariat | udyog bhawan | 10 | 0.3
+segment central secretariat | khan market | 20 | 2.1
+segment udyog bhawan | lok kalyan marg | 10 | 1.6
+segment khan market | jl nehru stadium | 10 | 1.4
+segment lok kalyan marg | jor bagh | 10 | 1.2
+segment jl nehru stadium | jangpura | 10 | 0.9
+)";
+
+string trimmed(const string &text)
+{
+    size_t b = text.find_first_not_of(" \t\r");
+    size_t e = text.find_last_not_of(" \t\r");
+    return b == string::npos ? "" : text.substr(b, e - b + 1);
+}
+
+string lowered(string text)
+{
+    for(int i = 0; i < (int)text.length(); ++i)
+    {
+        if(text[i] >= 'A' && text[i] <= 'Z')
+            text[i] += 32;
+    }
+    return text;
+}
+
+// Adds stations and segments from the text format; a station listed again only gains the new lines.
+// A reprice line sets new fares and distances on an existing segment.
+bool loadNetworkText(istream &in, const string &source)
+{
+    string text;
+    int number = 0;
+    while(getline(in, text))
+    {
+        ++number;
+        text = trimmed(text);
+        if(text.empty() || text[0] == '#')
+            continue;
+
+        size_t space = text.find(' ');
+        string kind = text.substr(0, space);
+        vector<string> fields;
+        for(size_t at = space; at != string::npos;)
+        {
+            size_t bar = text.find('|', at + 1);
+            fields.push_back(trimmed(text.substr(at + 1, bar == string::npos ? string::npos : bar - at - 1)));
+            at = bar;
+        }
+
+        if(kind == "station" && fields.size() >= 1 && fields[0].size())
+        {
+            string name = lowered(fields[0]);
+            if(m.getId(name) < 0)
+            {
+                m.addStationId(name);
+                s.addStation(name, stationIdUsed);
+            }
+
+            vector<string> color;
+            for(size_t at = 0; fields.size() > 1 && at != string::npos;)
+            {
+                size_t comma = fields[1].find(',', at);
+                string x = trimmed(fields[1].substr(at, comma == string::npos ? string::npos : comma - at));
+                if(x.size())
+                    color.push_back(x);
+                at = comma == string::npos ? comma : comma + 1;
+            }
+            if(!c.addColors(m.getId(name), color))
+            {
+                cerr << source << ":" << number << ": more than " << LineColors::MAX_LINES << " lines" << endl;
+                return false;
+            }
+
+            if(fields.size() == 4)
+            {
+                char *end1, *end2;
+                double lat = strtod(fields[2].c_str(), &end1);
+                double lon = strtod(fields[3].c_str(), &end2);
+                if(*end1 || *end2 || fields[2].empty() || fields[3].empty() || fabs(lat) > 90 || fabs(lon) > 180)
+                {
+                    cerr << source << ":" << number << ": bad coordinates '" << text << "'" << endl;
+                    return false;
+                }
+                m.locate(m.getId(name), lat, lon);
+            }
+        }
+        else if(kind == "segment" && fields.size() == 4)
+        {
+            int x = m.getId(lowered(fields[0]));
+            int y = m.getId(lowered(fields[1]));
+            char *end1, *end2;
+            long cost = strtol(fields[2].c_str(), &end1, 10);
+            double dist = strtod(fields[3].c_str(), &end2);
+            if(x < 0 || y < 0 || *end1 || *end2 || cost < 0 || dist < 0)
+            {
+                cerr << source << ":" << number << ": bad segment '" << text << "'" << endl;
+                return false;
+            }
+            l.addSegment(x, y, cost, dist);
+        }
+        else if(kind == "reprice" && fields.size() == 4)
+        {
+            int x = m.getId(lowered(fields[0]));
+            int y = m.getId(lowered(fields[1]));
+            char *end1, *end2;
+            long cost = strtol(fields[2].c_str(), &end1, 10);
+            double dist = strtod(fields[3].c_str(), &end2);
+            if(x < 0 || y < 0 || *end1 || *end2 || cost < 0 || dist < 0 || !l.repriceSegment(x, y, cost, dist))
+            {
+                cerr << source << ":" << number << ": bad reprice '" << text << "'" << endl;
+                return false;
+            }
+        }
+        else
+        {
+            cerr << source << ":" << number << ": cannot parse '" << text << "'" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+class NetworkHeader
+{
+public:
+    char magic[8];
+    uint32_t version;
+    uint32_t stations;
+    uint32_t nameBytes;
+    uint32_t lines;
+    uint32_t lineNameBytes;
+    uint32_t memberships;
+    uint32_t segments;
+    uint32_t trieNodes;
+    uint32_t labelBytes;
+    uint32_t reserved;
+};
+
+MappedFile networkSnapshot;
+
+// Snapshot sections: names, line names, station -> line ids, segments, the station trie arena and station coordinates,
+// each 8-byte aligned. Version 1 snapshots have no coordinates.
+bool writeNetworkSnapshot(const string &path)
+{
+    const LineGraph &net = l.lineGraph();
+    int n = stationIdUsed + 1;
+
+    vector<uint32_t> nameOffset(1, 0);
+    string names;
+    for(int i = 0; i < n; ++i)
+    {
+        names.append(m.stationFromId[i]);
+        nameOffset.push_back(names.size());
+    }
+
+    vector<uint32_t> lineOffset(1, 0);
+    string lineNames;
+    for(const string &x : net.lineNames)
+    {
+        lineNames += x;
+        lineOffset.push_back(lineNames.size());
+    }
+
+    vector<uint32_t> memberOffset(1, 0);
+    vector<int32_t> members;
+    for(int i = 0; i < n; ++i)
+    {
+        for(int x = net.first[i]; x < net.first[i + 1]; ++x)
+        {
+            if(net.line[x] >= 0)
+                members.push_back(net.line[x]);
+        }
+        memberOffset.push_back(members.size());
+    }
+
+    const vector<Segment> &segments = l.allSegments();
+    NetworkHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "DMRCNET\0", 8);
+    h.version = 2;
+    h.stations = n;
+    h.nameBytes = names.size();
+    h.lines = net.lineNames.size();
+    h.lineNameBytes = lineNames.size();
+    h.memberships = members.size();
+    h.segments = segments.size();
+    h.trieNodes = s.nodes.size();
+    h.labelBytes = s.labels.size();
+
+    BinaryWriter w(path);
+    w.put(&h, 1);
+    w.put(nameOffset.data(), nameOffset.size());
+    w.put(names.data(), names.size());
+    w.put(lineOffset.data(), lineOffset.size());
+    w.put(lineNames.data(), lineNames.size());
+    w.put(memberOffset.data(), memberOffset.size());
+    w.put(members.data(), members.size());
+    w.put(segments.data(), segments.size());
+    w.put(s.nodes.data(), s.nodes.size());
+    w.put(s.labels.data(), s.labels.size());
+    w.put(m.latitude.data(), n);
+    w.put(m.longitude.data(), n);
+    return (bool)w.out;
+}
+
+// Station names stay in the mapped file; only the trie arena and segment list are copied out in bulk.
+bool loadNetworkSnapshot(const string &path)
+{
+    if(!networkSnapshot.open(path))
+        return false;
+
+    BinaryReader r(networkSnapshot.data, networkSnapshot.size);
+    const NetworkHeader *h = r.take<NetworkHeader>(1);
+    if(!h || memcmp(h->magic, "DMRCNET\0", 8) != 0 || (h->version != 1 && h->version != 2) ||
+       h->stations >= INT_MAX || h->lines >= INT_MAX || h->trieNodes == 0 || h->trieNodes >= INT_MAX || h->labelBytes >= INT_MAX)
+        return false;
+
+    const uint32_t *nameOffset = r.take<uint32_t>((size_t)h->stations + 1);
+    const char *names = r.take<char>(h->nameBytes);
+    const uint32_t *lineOffset = r.take<uint32_t>((size_t)h->lines + 1);
+    const char *lineNames = r.take<char>(h->lineNameBytes);
+    const uint32_t *memberOffset = r.take<uint32_t>((size_t)h->stations + 1);
+    const int32_t *members = r.take<int32_t>(h->memberships);
+    const Segment *segments = r.take<Segment>(h->segments);
+    const TrieNode *nodes = r.take<TrieNode>(h->trieNodes);
+    const char *labels = r.take<char>(h->labelBytes);
+    const double *latitude = h->version >= 2 ? r.take<double>(h->stations) : NULL;
+    const double *longitude = h->version >= 2 ? r.take<double>(h->stations) : NULL;
+    if(!r.ok || !validOffsets(nameOffset, h->stations, h->nameBytes) || !validOffsets(lineOffset, h->lines, h->lineNameBytes) ||
+       !validOffsets(memberOffset, h->stations, h->memberships))
+        return false;
+
+    // Nothing is loaded unless every id and index in the file is in range, and the trie is a tree under node 0.
+    int stations = h->stations;
+    int trieNodes = h->trieNodes;
+    for(uint32_t k = 0; k < h->memberships; ++k)
+    {
+        if(members[k] < 0 || members[k] >= (int)h->lines)
+            return false;
+    }
+    for(uint32_t i = 0; i < h->segments; ++i)
+    {
+        const Segment &x = segments[i];
+        if(x.a < 0 || x.a >= stations || x.b < 0 || x.b >= stations || x.cost < 0 || !(x.distance >= 0))
+            return false;
+    }
+    vector<char> entered(trieNodes, 0);
+    for(int v = 0; v < trieNodes; ++v)
+    {
+        const TrieNode &x = nodes[v];
+        if(x.id < -1 || x.id >= stations || x.label < 0 || x.length < 0 || x.length > (int)h->labelBytes - x.label)
+            return false;
+        // Below the root every edge reads at least its first character, so an empty label would stall a walk.
+        if(v > 0 && (x.length == 0 || x.label >= (int)h->labelBytes))
+            return false;
+        for(int next : {x.child, x.sibling})
+        {
+            if(next == -1) continue;
+            if(next <= 0 || next >= trieNodes || entered[next])
+                return false;
+            entered[next] = 1;
+        }
+    }
+
+    m.stationFromId.reserve(h->stations);
+    for(uint32_t i = 0; i < h->stations; ++i)
+    {
+        m.addMappedStationId(string_view(names + nameOffset[i], nameOffset[i + 1] - nameOffset[i]));
+        if(latitude)
+            m.locate(i, latitude[i], longitude[i]);
+    }
+
+    vector<string> color;
+    for(uint32_t i = 0; i < h->stations; ++i)
+    {
+        color.clear();
+        for(uint32_t k = memberOffset[i]; k < memberOffset[i + 1]; ++k)
+        {
+            color.push_back(string(lineNames + lineOffset[members[k]], lineOffset[members[k] + 1] - lineOffset[members[k]]));
+        }
+        if(color.size())
+            c.addColors(i, color);
+    }
+
+    s.nodes.assign(nodes, nodes + h->trieNodes);
+    s.labels.assign(labels, h->labelBytes);
+    for(uint32_t i = 0; i < h->segments; ++i)
+    {
+        l.addSegment(segments[i].a, segments[i].b, segments[i].cost, segments[i].distance);
+    }
+    return true;
+}
+
+uint32_t crc32(const char *data, size_t len)
+{
+    static const vector<uint32_t> table = []
+    {
+        vector<uint32_t> t(256);
+        for(uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t x = i;
+            for(int k = 0; k < 8; ++k)
+            {
+                x = x & 1 ? 0xEDB88320U ^ (x >> 1) : x >> 1;
+            }
+            t[i] = x;
+        }
+        return t;
+    }();
+
+    uint32_t x = 0xFFFFFFFFU;
+    for(size_t i = 0; i < len; ++i)
+    {
+        x = table[(x ^ (unsigned char)data[i]) & 0xFF] ^ (x >> 8);
+    }
+    return x ^ 0xFFFFFFFFU;
+}
+
+bool syncFile(FILE *f)
+{
+    if(fflush(f) != 0)
+        return false;
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+// Admin edits as lines of the network text format, each framed by its length and CRC-32 so a torn last write is
+// found and cut off on replay. The edits apply on top of base snapshot number generation, or on the network given on
+// the command line while that is 0; compaction writes the next base and starts an empty journal for it, so replay
+// never covers more than COMPACT_EVERY edits.
+class Journal
+{
+public:
+    static const uint32_t VERSION = 1;
+    static const int COMPACT_EVERY = 4096;
+
+    class Header
+    {
+    public:
+        char magic[8];
+        uint32_t version;
+        uint32_t generation;
+        uint64_t origin;
+    };
+
+    string path;
+    uint32_t generation;
+    uint64_t origin;
+    int records;
+    bool enabled;
+    FILE *file;
+
+    Journal()
+    {
+        generation = 0;
+        origin = 0;
+        records = 0;
+        enabled = false;
+        file = NULL;
+    }
+
+    ~Journal()
+    {
+        if(file) fclose(file);
+    }
+
+    string basePath(uint32_t gen) const
+    {
+        return path + ".base" + to_string(gen);
+    }
+
+    // origin identifies the network the edits were made to. Returns false if the journal belongs to another one or
+    // is not a journal; edits are then not recorded.
+    bool open(const string &p, uint64_t o)
+    {
+        path = p;
+        origin = o;
+        generation = 0;
+        records = 0;
+        enabled = false;
+
+        ifstream in(path, ios::binary);
+        if(in)
+        {
+            Header h;
+            if(!in.read((char*)&h, sizeof(h)) || memcmp(h.magic, "DMRCJNL\0", 8) != 0 || h.version != VERSION || h.origin != origin)
+                return false;
+            generation = h.generation;
+        }
+        enabled = true;
+        return true;
+    }
+
+    // Applies every intact record in order and truncates whatever follows the last one. An intact record the network
+    // rejects is reported and skipped, so one bad edit does not hold back the rest. Returns the number applied.
+    int replay()
+    {
+        ifstream in(path, ios::binary);
+        if(!enabled || !in)
+            return 0;
+
+        int applied = 0;
+        uint64_t good = sizeof(Header);
+        in.seekg(good);
+        uint32_t frame[2];
+        string text;
+        while(in.read((char*)frame, sizeof(frame)) && frame[0] <= (1 << 20))
+        {
+            text.resize(frame[0]);
+            if(!in.read(&text[0], frame[0]) || crc32(text.data(), text.size()) != frame[1])
+                break;
+            istringstream line(text);
+            ++records;
+            if(loadNetworkText(line, path + " record " + to_string(records)))
+                ++applied;
+            else
+                cerr << "Journal " << path << ": skipped record " << records << ", which the network rejects" << endl;
+            good += sizeof(frame) + frame[0];
+        }
+        in.close();
+
+        error_code ec;
+        if(filesystem::file_size(path, ec) > good && !ec)
+        {
+            cerr << "Journal " << path << ": dropping a torn record after " << records << " edits" << endl;
+            filesystem::resize_file(path, good, ec);
+        }
+        return applied;
+    }
+
+    bool writeHeader(FILE *f, uint32_t gen)
+    {
+        Header h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, "DMRCJNL\0", 8);
+        h.version = VERSION;
+        h.generation = gen;
+        h.origin = origin;
+        return fwrite(&h, sizeof(h), 1, f) == 1;
+    }
+
+    bool append(const string &line)
+    {
+        if(!enabled)
+            return false;
+        if(!file)
+        {
+            error_code ec;
+            bool fresh = !filesystem::exists(path, ec);
+            file = fopen(path.c_str(), "ab");
+            if(!file || (fresh && !writeHeader(file, generation)))
+                return false;
+        }
+
+        uint32_t frame[2] = {(uint32_t)line.size(), crc32(line.data(), line.size())};
+        if(fwrite(frame, sizeof(frame), 1, file) != 1 || fwrite(line.data(), 1, line.size(), file) != line.size() || !syncFile(file))
+            return false;
+        if(++records >= COMPACT_EVERY)
+            compact();
+        return true;
+    }
+
+    // The new base is durable before the journal switches to it, and the old base goes only after, so a crash at any
+    // point leaves a journal whose base exists and already holds none of its edits.
+    bool compact()
+    {
+        if(!enabled)
+            return false;
+
+        uint32_t next = generation + 1;
+        string base = basePath(next);
+        string fresh = path + ".tmp";
+        if(!writeNetworkSnapshot(base))
+            return false;
+        FILE *f = fopen(base.c_str(), "rb+");
+        bool ok = f && syncFile(f);
+        if(f) fclose(f);
+
+        f = ok ? fopen(fresh.c_str(), "wb") : NULL;
+        ok = f && writeHeader(f, next) && syncFile(f);
+        if(f) fclose(f);
+        if(!ok)
+            return false;
+
+        if(file) fclose(file);
+        file = NULL;
+        error_code ec;
+        filesystem::rename(fresh, path, ec);
+        if(ec)
+            return false;
+        if(generation > 0)
+            filesystem::remove(basePath(generation), ec);
+        generation = next;
+        records = 0;
+        return true;
+    }
+};
+
+Journal journal;
+
+// Lines are "close station NAME", "close segment A | B", "reopen station NAME", "reopen segment A | B" or
+// "reopen all". Closures are runtime state and are not journalled.
+bool applyClosures(istream &in, const string &source)
+{
+    string text;
+    int number = 0;
+    while(getline(in, text))
+    {
+        ++number;
+        text = trimmed(text);
+        if(text.empty() || text[0] == '#')
+            continue;
+
+        istringstream words(text);
+        string action, kind, rest;
+        words >> action >> kind;
+        getline(words, rest);
+        size_t bar = rest.find('|');
+        string a = lowered(trimmed(rest.substr(0, bar)));
+        string b = bar == string::npos ? "" : lowered(trimmed(rest.substr(bar + 1)));
+        int x = m.getId(a);
+        int y = m.getId(b);
+        bool closed = action == "close";
+
+        bool ok = action == "close" || action == "reopen";
+        if(ok && kind == "all" && !closed)
+            l.reopenAll();
+        else if(ok && kind == "station" && x >= 0 && bar == string::npos)
+            l.setStationClosed(x, closed);
+        else if(!(ok && kind == "segment" && x >= 0 && y >= 0 && l.setSegmentClosed(x, y, closed)))
+        {
+            cerr << source << ":" << number << ": bad closure '" << text << "'" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs the report for the current closures against the network with everything open.
+template<class W>
+double assessClosures(Disruption<W> &report, int threads)
+{
+    auto started = chrono::steady_clock::now();
+    const Graph &after = l.graph();
+    Graph before;
+    before.build(after.n, l.allSegments());
+    report.run(before, after, l.closedStations(), l.closedSegments(), threads);
+    return chrono::duration<double>(chrono::steady_clock::now() - started).count();
+}
+
+template<class W>
+void writeDisruptions(const Disruption<W> &report, ostream &out, size_t limit)
+{
+    out << "from,to,before,after,change,status" << '\n';
+    for(size_t i = 0; i < report.changes.size() && i < limit; ++i)
+    {
+        const typename Disruption<W>::Change &x = report.changes[i];
+        out << m.stationFromId[x.from] << "," << m.stationFromId[x.to] << "," << x.before << ",";
+        if(x.after == Dijkstra<W>::infinity())
+            out << ",,unreachable" << '\n';
+        else
+            out << x.after << "," << x.after - x.before << ",longer" << '\n';
+    }
+}
+
+template<class W>
+void summariseDisruptions(const Disruption<W> &report, double seconds, ostream &out)
+{
+    size_t cut = 0;
+    for(const typename Disruption<W>::Change &x : report.changes)
+    {
+        cut += x.after == Dijkstra<W>::infinity();
+    }
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.2f", seconds);
+    out << report.changes.size() - cut << " pairs longer, " << cut << " cut off; " << report.recomputed << " of " <<
+           l.graph().n << " trees searched again in " << buf << " s" << endl;
+}
+
+// Cut-off pairs first, then the largest increases.
+template<class W>
+void showDisruptions(int limit)
+{
+    Disruption<W> report;
+    double seconds = assessClosures(report, 0);
+    summariseDisruptions(report, seconds, cout);
+    const W INF = Dijkstra<W>::infinity();
+    sort(report.changes.begin(), report.changes.end(), [INF](const typename Disruption<W>::Change &a, const typename Disruption<W>::Change &b)
+    {
+        if((a.after == INF) != (b.after == INF))
+            return a.after == INF;
+        return a.after == INF ? a.from < b.from : a.after - a.before > b.after - b.before;
+    });
+    cout << endl;
+    writeDisruptions(report, cout, limit);
+}
+
+
+// Writes a metro-like network in the text format: radial lines cross the centre, orbital lines are rings, and every
+// crossing is an interchange. Stations left over after filling the grid extend the radial lines past the outer ring.
+// Stations sit 1.2 km apart, closer on very large networks so the whole map stays within 300 km of the centre.
+bool generateNetwork(long long stations, uint64_t seed, ostream &out)
+{
+    int radial = max(2, (int)llround(pow((double)stations, 0.25) / 1.5));
+    int orbital = max(1, radial / 2);
+    int spokes = 2 * radial;
+    long long crossings = (long long)spokes * orbital;
+    if(stations < 1 + crossings)
+        return false;
+
+    long long between = (stations - 1 - crossings) / (2 * crossings);
+    long long tails = stations - 1 - crossings * (2 * between + 1);
+    uint64_t state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    auto jitter = [&state]()
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return 0.75 + (state >> 11) * (0.5 / 9007199254740992.0);
+    };
+
+    const double PI = 3.14159265358979323846;
+    const double SPACING = min(1.2, 300.0 / (orbital * (between + 1) + tails / spokes + 1));
+    vector<double> x, y;
+    vector<string> lines;
+    auto station = [&](double r, double a, const string &line)
+    {
+        x.push_back(r * cos(a));
+        y.push_back(r * sin(a));
+        lines.push_back(line);
+        return (long long)x.size() - 1;
+    };
+    auto name = [](long long id) { return "st" + to_string(id); };
+
+    vector<pair<long long, long long>> links;
+    vector<vector<long long>> crossing(spokes, vector<long long>(orbital));
+    long long centre = station(0, 0, "");
+    for(int i = 0; i < radial; ++i)
+    {
+        lines[centre] += (i ? "," : "") + string("R") + to_string(i + 1);
+    }
+
+    for(int sp = 0; sp < spokes; ++sp)
+    {
+        string line = "R" + to_string(sp % radial + 1);
+        double angle = 2 * PI * sp / spokes;
+        long long tail = tails / spokes + (sp < tails % spokes ? 1 : 0);
+        long long last = centre;
+        double r = 0;
+        for(int ring = 0; ring <= orbital; ++ring)
+        {
+            long long count = ring < orbital ? between + 1 : tail;
+            for(long long k = 0; k < count; ++k)
+            {
+                r += SPACING * jitter();
+                bool cross = ring < orbital && k == between;
+                long long v = station(r, angle, cross ? line + ",O" + to_string(ring + 1) : line);
+                links.push_back({last, v});
+                last = v;
+                if(cross)
+                    crossing[sp][ring] = v;
+            }
+        }
+    }
+
+    for(int ring = 0; ring < orbital; ++ring)
+    {
+        string line = "O" + to_string(ring + 1);
+        for(int sp = 0; sp < spokes; ++sp)
+        {
+            long long from = crossing[sp][ring];
+            long long to = crossing[(sp + 1) % spokes][ring];
+            double r = hypot(x[from], y[from]);
+            double a0 = 2 * PI * sp / spokes;
+            long long last = from;
+            for(long long k = 1; k <= between; ++k)
+            {
+                long long v = station(r, a0 + 2 * PI / spokes * k / (between + 1), line);
+                links.push_back({last, v});
+                last = v;
+            }
+            links.push_back({last, to});
+        }
+    }
+
+    const double LAT = 28.6139, LON = 77.2090;
+    char buf[128];
+    out << "# Synthetic network: " << x.size() << " stations, " << radial << " radial and " << orbital << " orbital lines, seed " << seed << "\n";
+    for(size_t v = 0; v < x.size(); ++v)
+    {
+        double lat = LAT + y[v] / 110.574;
+        snprintf(buf, sizeof(buf), " | %.6f | %.6f\n", lat, LON + x[v] / (111.320 * cos(lat * PI / 180)));
+        out << "station " << name(v) << " | " << lines[v] << buf;
+    }
+    for(const pair<long long, long long> &e : links)
+    {
+        double kms = hypot(x[e.first] - x[e.second], y[e.first] - y[e.second]) * jitter();
+        snprintf(buf, sizeof(buf), " | %d | %.2f\n", max(1, (int)llround(kms * 6)), kms);
+        out << "segment " << name(e.first) << " | " << name(e.second) << buf;
+    }
+    return (bool)out;
+}
+
+void generatePath(vector<string> &journey) { }
+
+void displayFunctions()
+{
+    cout << "========================================" << endl;
+    cout << "     DELHI METRO NAVIGATION SYSTEM     " << endl;
+    cout << "========================================" << endl << endl;
+    cout << "What would you like to do?" << endl;
+    cout << "1. Display List Of Stations" << endl;
+    cout << "2. See Network of Stations" << endl;
+    cout << "3. Complete Map of MetroLines" << endl;
+    cout << "4. Cheapest way to reach your Destination" << endl;
+    cout << "5. Fastest way to reach your Destination" << endl;
+    cout << "6. Add Stations (Admin Only)" << endl;
+    cout << "7. Route Settings" << endl;
+    cout << "8. All route options (cost / distance / interchanges)" << endl;
+    cout << "9. Alternative routes (Operations)" << endl;
+    cout << "10. Earliest arrival by timetable" << endl;
+    cout << "11. Reprice a segment (Admin Only)" << endl;
+    cout << "12. Stations within a fare, distance or interchange budget" << endl;
+    cout << "13. Close stations or segments (Admin Only)" << endl;
+    cout << "0. Exit" << endl << endl;
+}
+
+void showmap()
+{
+    system("cls");
+    cout << "----------------------------------------------------METRO LINES NETWORK-------------------------------------------------" << endl << endl;
+    const LineGraph &net = l.lineGraph();
+    cout << "Metro system initialized with " << stationIdUsed + 1 << " stations across " << net.lineNames.size() << " lines (";
+    for(int i = 0; i < (int)net.lineNames.size(); ++i)
+    {
+        cout << (i ? ", " : "") << net.lineNames[i];
+    }
+    cout << ")" << endl;
+    cout << "Use options 1 and 2 to explore stations and connections" << endl;
+    cout << endl << "------------------------------------------------------------------------------------------------------------------------" << endl;
+    cout << endl << "Press any key to go back...";
+    getch();
+    system("cls");
+}
+
+void cheapest();
+void fastest();
+void allOptions();
+void alternatives();
+void timed();
+void repriceSegment();
+void withinBudget();
+void addStation();
+void routeSettings();
+void closures();
+void home();
+
+bool suggest(string &name)
+{
+    vector<int> found = s.complete(name, 6);
+    if(found.empty() || name.empty())
+    {
+        found.clear();
+        vector<pair<int, int>> near = s.fuzzy(name, name.size() <= 4 ? 1 : 2);
+        for(int i = 0; i < (int)near.size() && near[i].first == near[0].first; ++i)
+        {
+            found.push_back(near[i].second);
+        }
+    }
+
+    system("cls");
+    if(found.size() == 1)
+    {
+        name = m.stationFromId[found[0]];
+        cout << "Showing results for '" << name << "'" << endl << endl;
+        return true;
+    }
+    if(found.size() > 1)
+    {
+        cout << "Did you mean:";
+        for(int i = 0; i < (int)found.size() && i < 5; ++i)
+        {
+            cout << (i ? ", " : " ") << m.stationFromId[found[i]];
+        }
+        cout << endl;
+    }
+    return false;
+}
+
+bool readJourney(string &src, string &dest)
+{
+    cin.ignore();
+B:
+    cout << "Enter starting station ('back' to go back): ";
+    string org;
+    getline(cin, src);
+    org = src;
+    bool digit = src.length() > 0 && src.length() < 10;
+    for(int i = 0; i < (int)src.length(); ++i)
+    {
+        if(src[i] < '0' || src[i] > '9')
+            digit = false;
+    }
+
+    if(digit)
+    {
+        if(stoi(src) >= 0 && stoi(src) <= stationIdUsed)
+            src = m.stationFromId[stoi(src)];
+    }
+
+    for(int i = 0; !digit && i < (int)src.length(); ++i)
+    {
+        if(src[i] >= 'A' && src[i] <= 'Z')
+            src[i] += 32;
+    }
+    if(src == "back")
+    {
+        return false;
+    }
+    if(s.find(src) < 0 && (digit || !suggest(src)))
+    {
+        cout << "Invalid Starting Location" << endl << endl;
+        goto B;
+    }
+
+C:
+    cout << "Enter destination station ('back' to go back): ";
+    getline(cin, dest);
+
+    digit = dest.length() > 0 && dest.length() < 10;
+    for(int i = 0; i < (int)dest.length(); ++i)
+    {
+        if(dest[i] < '0' || dest[i] > '9')
+            digit = false;
+    }
+
+    if(digit)
+    {
+        if(stoi(dest) >= 0 && stoi(dest) <= stationIdUsed)
+            dest = m.stationFromId[stoi(dest)];
+    }
+
+    for(int i = 0; !digit && i < (int)dest.length(); ++i)
+    {
+        if(dest[i] >= 'A' && dest[i] <= 'Z')
+            dest[i] += 32;
+    }
+    if(dest == "back")
+    {
+        return false;
+    }
+    if(s.find(dest) < 0 && (digit || !suggest(dest)))
+    {
+        cout << "Invalid Destination Location" << endl << endl;
+        cout << "Enter starting location : " << org << endl;
+        goto C;
+    }
+    return true;
+}
+
+void cheapest()
+{
+    string src, dest;
+    if(!readJourney(src, dest))
+    {
+        system("cls");
+        home();
+        return;
+    }
+    system("cls");
+    l.cheapestRoute(src, dest);
+
+    cout << endl << endl;
+    cout << "Press any key to go back... ";
+    getch();
+    system("cls");
+    home();
+}
+
+void fastest()
+{
+    string src, dest;
+    if(!readJourney(src, dest))
+    {
+        system("cls");
+        home();
+        return;
+    }
+    system("cls");
+    l.ShortestRoute(src, dest);
+
+    cout << endl << endl;
+    cout << "Press any key to go back... ";
+    getch();
+    system("cls");
+    home();
+}
+
+void allOptions()
+{
+    string src, dest;
+    if(!readJourney(src, dest))
+    {
+        system("cls");
+        home();
+        return;
+    }
+    system("cls");
+    l.allRoutes(src, dest);
+
+    cout << endl << endl;
+    cout << "Press any key to go back... ";
+    getch();
+    system("cls");
+    home();
+}
+
+void alternatives()
+{
+    cout << "Rank alternatives by (1) cost or (2) distance: ";
+    int criterion;
+    cin >> criterion;
+    cout << "How many routes: ";
+    int k;
+    cin >> k;
+    if(!cin || (criterion != 1 && criterion != 2) || k <= 0)
+    {
+        cin.clear();
+        cin.ignore(INT_MAX, '\n');
+        system("cls");
+        home();
+        return;
+    }
+
+    string src, dest;
+    if(!readJourney(src, dest))
+    {
+        system("cls");
+        home();
+        return;
+    }
+    system("cls");
+    l.alternativeRoutes(src, dest, min(k, 50), criterion == 1);
+
+    cout << endl << endl;
+    cout << "Press any key to go back... ";
+    getch();
+    system("cls");
+    home();
+}
+
+void timed()
+{
+    cout << "Enter departure time as HH:MM, or a range HH:MM-HH:MM: ";
+    string when;
+    cin >> when;
+
+    size_t dash = when.find('-');
+    int start = parseClock(when.substr(0, dash));
+    int end = dash == string::npos ? -1 : parseClock(when.substr(dash + 1));
+    if(start < 0 || (dash != string::npos && end < start))
+    {
+        system("cls");
+        cout << "Invalid time" << endl << endl;
+        home();
+        return;
+    }
+
+    string src, dest;
+    if(!readJourney(src, dest))
+    {
+        system("cls");
+        home();
+        return;
+    }
+    system("cls");
+    l.timedRoute(src, dest, start, end);
+
+    cout << endl << endl;
+    cout << "Press any key to go back... ";
+    getch();
+    system("cls");
+    home();
+}
+
+void withinBudget()
+{
+    cout << "Budget by (1) fare, (2) distance or (3) interchanges: ";
+    int kind;
+    cin >> kind;
+    cout << "Budget: ";
+    double budget;
+    cin >> budget;
+    if(!cin || kind < 1 || kind > 3 || budget < 0)
+    {
+        cin.clear();
+        cin.ignore(INT_MAX, '\n');
+        system("cls");
+        home();
+        return;
+    }
+
+    cin.ignore();
+    string src;
+    cout << "Enter starting station: ";
+    getline(cin, src);
+    int from = resolveStation(src);
+    if(from < 0 && suggest(src))
+        from = resolveStation(src);
+
+    system("cls");
+    if(from < 0)
+        cout << "Invalid Starting Location" << endl;
+    else
+        l.reachable(string(m.stationFromId[from]), kind - 1, budget);
+
+    cout << endl << "Press any key to go back... ";
+    getch();
+    system("cls");
+    home();
+}
+
+bool adminLogin()
+{
+    for(;;)
+    {
+        system("cls");
+        string pass;
+        cout << "Enter Password ('back' to go back): ";
+        int ch = 'A';
+
+        while(ch != 13 && ch != EOF)
+        {
+            ch = getch();
+
+            if(isprint(ch))
+            {
+                cout << "*";
+                pass.push_back(ch);
+            }
+            else if(ch == 8 && pass.length())
+            {
+                pass.pop_back();
+                cout << "\b \b";
+            }
+        }
+
+        if(pass == "back" || ch == EOF)
+            return false;
+        if(pass == "yes")
+            return true;
+
+        system("cls");
+        cout << "ERROR!!!! INVALID PASSWORD !" << endl << endl;
+        cout << "Press any key to go back and try again... ";
+        getch();
+    }
+}
+
+void repriceSegment()
+{
+    if(!adminLogin())
+    {
+        system("cls");
+        home();
+        return;
+    }
+
+    system("cls");
+    cout << "***Login Successful***" << endl << endl;
+
+    string a, b;
+    int cost;
+    double dist;
+    cin.ignore();
+    cout << "Enter first station of the segment: ";
+    getline(cin, a);
+    cout << "Enter second station of the segment: ";
+    getline(cin, b);
+    cout << "Enter new cost of travel: ";
+    cin >> cost;
+    cout << "Enter new distance between stations: ";
+    cin >> dist;
+
+    int x = resolveStation(a);
+    int y = resolveStation(b);
+    if(!cin || cost < 0 || dist < 0)
+    {
+        cin.clear();
+        cin.ignore(INT_MAX, '\n');
+        cout << endl << "Invalid cost or distance" << endl;
+    }
+    else if(x < 0 || y < 0 || !l.repriceSegment(x, y, cost, dist))
+        cout << endl << "No direct segment between those stations" << endl;
+    else
+    {
+        ostringstream line;
+        line << "reprice " << m.stationFromId[x] << " | " << m.stationFromId[y] << " | " << cost << " | " << dist;
+        journal.append(line.str());
+        cout << endl << "Segment repriced successfully..." << endl;
+    }
+
+    cout << "Press any key to go back...";
+    getch();
+    system("cls");
+    home();
+}
+
+void addStation()
+{
+    if(!adminLogin())
+    {
+        system("cls");
+        home();
+        return;
+    }
+
+    system("cls");
+    cout << "***Login Successful***" << endl << endl;
+
+    string name;
+    cout << "Enter station Name: ";
+    cin.ignore();
+    getline(cin, name);
+    for(int i = 0; i < (int)name.length(); ++i)
+    {
+        if(name[i] >= 'A' && name[i] <= 'Z')
+            name[i] += 32;
+    }
+    // The journal replays this as a station line, which must name a new station for the replay to match.
+    name = trimmed(name);
+    if(name.empty() || name.find('|') != string::npos || m.getId(name) >= 0)
+    {
+        if(name.empty())
+            cout << endl << "Station name cannot be empty" << endl;
+        else if(m.getId(name) >= 0)
+            cout << endl << "Station '" << name << "' already exists" << endl;
+        else
+            cout << endl << "Station name cannot contain '|'" << endl;
+        cout << "Press any key to go back...";
+        getch();
+        system("cls");
+        home();
+        return;
+    }
+    m.addStationId(name);
+    s.addStation(name, stationIdUsed);
+
+    vector<string> color;
+    string temp;
+    int i = 1;
+
+    while(i)
+    {
+        cout << "Enter color number " << i << " (NULL to stop entering): ";
+        getline(cin, temp);
+        if(temp == "NULL")
+            break;
+        color.push_back(temp);
+        i++;
+    }
+
+    if(!c.addColors(stationIdUsed, color))
+        cout << "Only " << LineColors::MAX_LINES << " lines are supported, extra colours were skipped" << endl;
+    string line = "station " + name + " |";
+    for(int k = 0; k < (int)color.size(); ++k)
+    {
+        line += (k ? "," : " ") + color[k];
+    }
+    journal.append(line);
+    i = 1;
+    int cost;
+    double dist;
+    while(i)
+    {
+        cout << "Enter directly connected Station number " << i << " (NULL to stop entering): ";
+        if(i > 1)
+            cin.ignore();
+        getline(cin, temp);
+        if(temp == "NULL")
+            break;
+        cout << "Enter cost of travel: ";
+        cin >> cost;
+        cout << "Enter distance between stations: ";
+        cin >> dist;
+        if(!l.addLine(name, temp, cost, dist))
+            cout << "Unknown station '" << temp << "', connection skipped" << endl;
+        else
+        {
+            ostringstream segment;
+            segment << "segment " << name << " | " << temp << " | " << cost << " | " << dist;
+            journal.append(segment.str());
+        }
+        i++;
+    }
+
+    cout << endl;
+    cout << "Adding Station";
+    for(int i = 1; i < 6; i++)
+    {
+        for(int j = 0; j < 200000000; j++)
+        {
+        }
+        cout << ".";
+    }
+    cout << endl << endl;
+
+    cout << "Station added successfully..." << endl;
+    cout << "Press any key to go back...";
+    getch();
+    system("cls");
+    home();
+}
+
+void routeSettings()
+{
+    system("cls");
+    cout << "ROUTE SETTINGS" << endl << endl;
+    cout << "Line-aware routing: " << (l.lineAware ? "ON" : "OFF") << endl;
+    cout << "Guided search (A* by distance, bidirectional by cost): " << (l.guided ? "ON" : "OFF") << endl;
+    cout << "Interchange penalty: rupees " << l.transferCost << " and " << l.transferDistance << " kms" << endl;
+    cout << "Route cache: " << l.cache.size() << " routes, " << l.cache.hits << " hits, " << l.cache.misses << " misses, ";
+    cout << l.cache.evictions << " evictions, " << l.cache.invalidations << " invalidations" << endl << endl;
+    cout << "1. Toggle line-aware routing" << endl;
+    cout << "2. Change interchange penalty" << endl;
+    cout << "3. Toggle guided search" << endl;
+    cout << "0. Go back" << endl << endl;
+    cout << "Enter Your Choice: ";
+
+    int choice;
+    cin >> choice;
+    if(choice == 1)
+    {
+        l.lineAware = !l.lineAware;
+    }
+    else if(choice == 2)
+    {
+        int cost;
+        double dist;
+        cout << "Enter interchange penalty in rupees: ";
+        cin >> cost;
+        cout << "Enter interchange penalty in kms: ";
+        cin >> dist;
+        if(cin && cost >= 0 && dist >= 0)
+            l.setTransferPenalty(cost, dist);
+    }
+    else if(choice == 3)
+    {
+        l.guided = !l.guided;
+    }
+    if(!cin)
+    {
+        cin.clear();
+        cin.ignore(INT_MAX, '\n');
+    }
+
+    system("cls");
+    if(choice >= 1 && choice <= 3)
+        routeSettings();
+}
+
+void closures()
+{
+    if(!adminLogin())
+    {
+        system("cls");
+        home();
+        return;
+    }
+
+    for(;;)
+    {
+        system("cls");
+        cout << "CLOSURES" << endl << endl;
+        vector<int> stations = l.closedStations();
+        vector<pair<int, int>> segments = l.closedSegments();
+        if(stations.empty() && segments.empty())
+            cout << "Every station and segment is open" << endl;
+        for(int v : stations)
+        {
+            cout << "Closed station: " << m.stationFromId[v] << endl;
+        }
+        for(const pair<int, int> &x : segments)
+        {
+            cout << "Closed segment: " << m.stationFromId[x.first] << " - " << m.stationFromId[x.second] << endl;
+        }
+        cout << endl;
+        cout << "1. Close a station" << endl;
+        cout << "2. Close a segment" << endl;
+        cout << "3. Reopen everything" << endl;
+        cout << "4. Journeys affected, by fare" << endl;
+        cout << "5. Journeys affected, by distance" << endl;
+        cout << "0. Go back" << endl << endl;
+        cout << "Enter Your Choice: ";
+
+        int choice;
+        cin >> choice;
+        if(!cin)
+        {
+            cin.clear();
+            cin.ignore(INT_MAX, '\n');
+            continue;
+        }
+        if(choice == 0)
+            break;
+
+        if(choice == 1 || choice == 2)
+        {
+            string a, b;
+            cin.ignore();
+            cout << "Enter station: ";
+            getline(cin, a);
+            int x = resolveStation(a);
+            int y = -1;
+            if(choice == 2)
+            {
+                cout << "Enter the other station of the segment: ";
+                getline(cin, b);
+                y = resolveStation(b);
+            }
+            if(choice == 1 && x >= 0)
+                l.setStationClosed(x, true);
+            else if(choice == 1 || x < 0 || y < 0 || !l.setSegmentClosed(x, y, true))
+            {
+                cout << endl << (choice == 1 ? "Unknown station" : "No direct segment between those stations") << endl;
+                cout << "Press any key to go back...";
+                getch();
+            }
+        }
+        else if(choice == 3)
+            l.reopenAll();
+        else if(choice == 4 || choice == 5)
+        {
+            system("cls");
+            if(choice == 4)
+                showDisruptions<int>(20);
+            else
+                showDisruptions<double>(20);
+            cout << endl << "Press any key to go back...";
+            getch();
+        }
+    }
+
+    system("cls");
+    home();
+}
+
+void home()
+{
+    displayFunctions();
+    cout << "Enter Your Choice: ";
+    int choice;
+A:
+    cin >> choice;
+
+    switch(choice)
+    {
+    case 0:
+        break;
+    case 1:
+        m.displayAll();
+        home();
+        break;
+
+    case 2:
+        l.displayNetwork();
+        home();
+        break;
+
+    case 3:
+        system("cls");
+        showmap();
+        home();
+        break;
+
+    case 4:
+        system("cls");
+        cheapest();
+        break;
+
+    case 5:
+        system("cls");
+        fastest();
+        break;
+
+    case 6:
+        system("cls");
+        addStation();
+        break;
+
+    case 7:
+        routeSettings();
+        home();
+        break;
+
+    case 8:
+        system("cls");
+        allOptions();
+        break;
+
+    case 9:
+        system("cls");
+        alternatives();
+        break;
+
+    case 10:
+        system("cls");
+        timed();
+        break;
+
+    case 11:
+        system("cls");
+        repriceSegment();
+        break;
+
+    case 12:
+        system("cls");
+        withinBudget();
+        break;
+
+    case 13:
+        system("cls");
+        closures();
+        break;
+
+    default:
+        system("cls");
+        displayFunctions();
+        cout << "Oops!!! Invalid Input.... Enter your choice again: ";
+        goto A;
+    }
+}
+
+// An edit is one station, segment or reprice line of the network text format, or a closure. It changes the live network
+// and publishes it as a new version; queries already running finish on the version they pinned. Only network edits
+// are journalled.
+bool applyEdit(const string &line, string &row)
+{
+    lock_guard<mutex> hold(versions.writer);
+    istringstream in(line);
+    bool closure = line.compare(0, 6, "close ") == 0 || line.compare(0, 7, "reopen ") == 0;
+    if(closure ? !applyClosures(in, "edit") : !loadNetworkText(in, "edit"))
+    {
+        row = "edit,,failed";
+        return false;
+    }
+    if(!closure)
+        journal.append(line);
+    const NetworkVersion *v = l.snapshot();
+    versions.publish(v);
+    row = "edit," + to_string(v->number) + ",ok";
+    return true;
+}
+
+// A query is "source,destination[,criterion[,line|plain[,guided|dijkstra]]]"; the answer is the matching batch output row.
+void answerQuery(const string &q, const NetworkVersion &v, RouteWorker &w, bool lineAware, bool guided, string &row)
+{
+    auto started = chrono::steady_clock::now();
+    vector<string> fields;
+    size_t start = 0;
+    for(;;)
+    {
+        size_t comma = q.find(',', start);
+        fields.push_back(q.substr(start, comma == string::npos ? string::npos : comma - start));
+        if(comma == string::npos) break;
+        start = comma + 1;
+    }
+
+    string src = fields[0];
+    string dest = fields.size() > 1 ? fields[1] : "";
+    string criterion = fields.size() > 2 ? fields[2] : "cost";
+    string mode = fields.size() > 3 ? fields[3] : "";
+    string search = fields.size() > 4 ? fields[4] : "";
+    for(string *f : {&criterion, &mode, &search})
+    {
+        f->erase(remove_if(f->begin(), f->end(), ::isspace), f->end());
+        for(char &ch : *f) ch = tolower(ch);
+    }
+
+    int from = v.resolve(src);
+    int to = v.resolve(dest);
+    bool byCost = criterion == "cost" || criterion == "cheapest" || criterion == "fare";
+    bool byDist = criterion == "distance" || criterion == "shortest" || criterion == "fastest";
+    if(mode == "line")
+        lineAware = true;
+    else if(mode == "plain")
+        lineAware = false;
+    if(search == "guided")
+        guided = true;
+    else if(search == "dijkstra")
+        guided = false;
+
+    RouteResult r;
+    char buf[128];
+    row = src + "," + dest + "," + (byCost ? "cost" : byDist ? "distance" : criterion) + ",";
+    if(!byCost && !byDist)
+        row += ",,,,bad criterion";
+    else if(!mode.empty() && mode != "line" && mode != "plain")
+        row += ",,,,bad mode";
+    else if(!search.empty() && search != "guided" && search != "dijkstra")
+        row += ",,,,bad search";
+    else if(from < 0 || to < 0)
+        row += ",,,,unknown station";
+    else if(!findRoute(v.net, v.states, v.table, v.hubs, v.ch, guided ? &v.geo : NULL, w, from, to, byCost, lineAware, r, &v.cache))
+        row += ",,,,no route";
+    else
+    {
+        snprintf(buf, sizeof(buf), "%d,%.2f,%d,%d,ok", r.cost, r.distance, (int)r.path.size() - 1, r.interchanges);
+        row += buf;
+    }
+    if(metrics.enabled)
+        metrics.time(QueryMetrics::ANSWER, started);
+}
+
+// Each input line is a query as answerQuery reads it; answers come back as CSV rows in input order.
+void runBatch(istream &in, ostream &out, int threads)
+{
+    {
+        lock_guard<mutex> hold(versions.writer);
+        versions.publish(l.snapshot());
+    }
+    const NetworkVersion &v = *versions.current;
+    bool lineAware = l.lineAware;
+    bool guided = l.guided;
+
+    ThreadPool pool(threads);
+    vector<RouteWorker> workers(pool.size());
+    const size_t BLOCK = 1 << 16;
+    vector<string> queries;
+    vector<string> results;
+    string text;
+    bool more = true;
+
+    out << "source,destination,criterion,cost,distance,hops,interchanges,status" << '\n';
+    while(more)
+    {
+        queries.clear();
+        while(queries.size() < BLOCK)
+        {
+            if(!getline(in, text))
+            {
+                more = false;
+                break;
+            }
+            if(text.empty() || text[0] == '#' || text == "\r") continue;
+            queries.push_back(text);
+        }
+
+        results.assign(queries.size(), string());
+        pool.parallelFor(queries.size(), 256, [&](int w, size_t b, size_t e)
+        {
+            for(size_t i = b; i < e; ++i)
+            {
+                answerQuery(queries[i], v, workers[w], lineAware, guided, results[i]);
+            }
+        });
+
+        for(const string &row : results)
+        {
+            out << row << '\n';
+        }
+    }
+    out.flush();
+}
+
+// "-" writes to stderr, which keeps stdout free for batch output.
+bool writeMetrics(const string &path)
+{
+    if(path == "-")
+    {
+        metrics.write(cerr);
+        cerr << endl;
+        return true;
+    }
+    ofstream out(path);
+    metrics.write(out);
+    out << '\n';
+    out.close();
+    if(!out)
+    {
+        cerr << "Could not write query statistics to " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+class IsochroneHeader
+{
+public:
+    char magic[8];
+    uint32_t version;
+    uint32_t stations;
+    uint32_t kind;
+    uint32_t reserved;
+    double budget;
+    uint64_t entries;
+};
+
+class IsochroneEntry
+{
+public:
+    int32_t station;
+    float value;
+};
+
+// Matrix layout: header, then each source's reachable stations in increasing order of value, then stations + 1 row
+// offsets into the entries; the header is rewritten with the entry count once every row is out.
+bool writeIsochrones(const string &path, int kind, double budget, int threads)
+{
+    const Graph &net = l.graph();
+    const LineGraph &states = l.lineGraph();
+    ThreadPool pool(threads);
+    vector<Isochrone> workers(pool.size());
+
+    IsochroneHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "DMRCISO\0", 8);
+    h.version = 1;
+    h.stations = net.n;
+    h.kind = kind;
+    h.budget = budget;
+
+    BinaryWriter w(path);
+    w.put(&h, 1);
+    vector<uint64_t> offsets(1, 0);
+    const int BLOCK = 4096;
+    vector<vector<IsochroneEntry>> rows(BLOCK);
+    for(int base = 0; base < net.n; base += BLOCK)
+    {
+        int count = min(BLOCK, net.n - base);
+        pool.parallelFor(count, 16, [&](int t, size_t b, size_t e)
+        {
+            vector<pair<int, double>> found;
+            for(size_t i = b; i < e; ++i)
+            {
+                workers[t].run(net, states, base + i, kind, budget, found);
+                rows[i].resize(found.size());
+                for(size_t k = 0; k < found.size(); ++k)
+                {
+                    rows[i][k].station = found[k].first;
+                    rows[i][k].value = found[k].second;
+                }
+            }
+        });
+        for(int i = 0; i < count; ++i)
+        {
+            w.put(rows[i].data(), rows[i].size());
+            offsets.push_back(offsets.back() + rows[i].size());
+        }
+    }
+    w.put(offsets.data(), offsets.size());
+
+    h.entries = offsets.back();
+    w.out.seekp(0);
+    w.put(&h, 1);
+    return (bool)w.out;
+}
+
+// Demand lines are "origin,destination,trips". Origins are shared out over the pool, each worker adds into its own
+// Assignment, and the per-worker loads are merged at the end.
+bool runAssignment(istream &in, ostream &out, int k, bool byCost, int threads)
+{
+    const Graph &net = l.graph();
+    const LineGraph &states = l.lineGraph();
+    vector<vector<pair<int, double>>> demand(net.n);
+    string text;
+    long long number = 0, skipped = 0;
+    while(getline(in, text))
+    {
+        ++number;
+        if(text.empty() || text[0] == '#' || text == "\r") continue;
+        size_t p1 = text.find(',');
+        size_t p2 = p1 == string::npos ? string::npos : text.find(',', p1 + 1);
+        if(p2 == string::npos)
+        {
+            cerr << "line " << number << ": expected origin,destination,trips" << endl;
+            return false;
+        }
+        int from = resolveStation(text.substr(0, p1));
+        int to = resolveStation(text.substr(p1 + 1, p2 - p1 - 1));
+        char *end;
+        double trips = strtod(text.c_str() + p2 + 1, &end);
+        if(from < 0 || to < 0 || !(trips >= 0))
+        {
+            ++skipped;
+            continue;
+        }
+        if(from != to && trips > 0)
+            demand[from].push_back({to, trips});
+    }
+
+    vector<int> origins;
+    for(int v = 0; v < net.n; ++v)
+    {
+        if(demand[v].size())
+            origins.push_back(v);
+    }
+
+    vector<int> plainArc = DemandAssigner::plainArcs(net, states, byCost);
+    ThreadPool pool(threads);
+    vector<DemandAssigner> workers(pool.size());
+    vector<Assignment> loads(pool.size());
+    for(Assignment &x : loads)
+    {
+        x.reset(net);
+    }
+    pool.parallelFor(origins.size(), 1, [&](int w, size_t b, size_t e)
+    {
+        for(size_t i = b; i < e; ++i)
+        {
+            workers[w].assign(net, states, plainArc, origins[i], demand[origins[i]], byCost, k, loads[w]);
+        }
+    });
+    for(size_t w = 1; w < loads.size(); ++w)
+    {
+        loads[0].merge(loads[w]);
+    }
+    const Assignment &total = loads[0];
+
+    char buf[64];
+    out << "kind,from,to,passengers" << '\n';
+    for(int u = 0; u < net.n; ++u)
+    {
+        for(int e = net.offset[u]; e < net.offset[u + 1]; ++e)
+        {
+            if(total.arcLoad[e] == 0) continue;
+            snprintf(buf, sizeof(buf), "%.2f", total.arcLoad[e]);
+            out << "segment," << m.stationFromId[u] << "," << m.stationFromId[net.target[e]] << "," << buf << '\n';
+        }
+    }
+    for(int v = 0; v < net.n; ++v)
+    {
+        if(total.transfers[v] == 0) continue;
+        snprintf(buf, sizeof(buf), "%.2f", total.transfers[v]);
+        out << "interchange," << m.stationFromId[v] << ",," << buf << '\n';
+    }
+    out.flush();
+
+    snprintf(buf, sizeof(buf), "%.0f trips from %d origins, %.0f", total.assigned, (int)origins.size(), total.unassigned);
+    cerr << "Assigned " << buf << " trips without a route, " << skipped << " lines with unknown stations" << endl;
+    return true;
+}
+
+// Ranks stations and segments by the shortest routes through them. samples > 0 runs from that many random sources
+// and scales up, which keeps planning runs on large networks to a fixed cost.
+template<class W>
+void runBetweenness(int samples, int top, int threads, uint64_t seed)
+{
+    auto started = chrono::steady_clock::now();
+    const Graph &net = l.graph();
+    vector<int> sources(net.n);
+    for(int v = 0; v < net.n; ++v)
+    {
+        sources[v] = v;
+    }
+    if(samples > 0 && samples < net.n)
+    {
+        uint64_t state = seed * 0x9E3779B97F4A7C15ULL + 1;
+        for(int i = 0; i < samples; ++i)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            swap(sources[i], sources[i + state % (net.n - i)]);
+        }
+        sources.resize(samples);
+    }
+
+    ThreadPool pool(threads);
+    vector<Brandes<W>> workers(pool.size());
+    for(Brandes<W> &x : workers)
+    {
+        x.reset(net);
+    }
+    pool.parallelFor(sources.size(), 1, [&](int w, size_t b, size_t e)
+    {
+        for(size_t i = b; i < e; ++i)
+        {
+            workers[w].run(net, sources[i]);
+        }
+    });
+    for(size_t w = 1; w < workers.size(); ++w)
+    {
+        workers[0].merge(workers[w]);
+    }
+    const Brandes<W> &total = workers[0];
+
+    // Every route is counted once from each end.
+    double scale = sources.empty() ? 0 : (double)net.n / sources.size() / 2;
+    double pairs = max(1.0, (double)(net.n - 1) * (net.n - 2) / 2);
+    vector<pair<double, int>> stations;
+    for(int v = 0; v < net.n; ++v)
+    {
+        stations.push_back({total.station[v] * scale, v});
+    }
+    unordered_map<uint64_t, double> joined;
+    for(int u = 0; u < net.n; ++u)
+    {
+        for(int e = net.offset[u]; e < net.offset[u + 1]; ++e)
+        {
+            if(total.arc[e] > 0)
+                joined[(uint64_t)min(u, net.target[e]) << 32 | max(u, net.target[e])] += total.arc[e] * scale;
+        }
+    }
+    vector<pair<double, pair<int, int>>> segments;
+    for(const pair<const uint64_t, double> &x : joined)
+    {
+        segments.push_back({x.second, {(int)(x.first >> 32), (int)(x.first & 0xFFFFFFFFULL)}});
+    }
+    auto byScore = [](const auto &a, const auto &b) { return a.first > b.first; };
+    sort(stations.begin(), stations.end(), byScore);
+    sort(segments.begin(), segments.end(), byScore);
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    printf("Betweenness by %s from %d of %d stations in %.2f s\n\n", sizeof(W) == sizeof(int) ? "cost" : "distance",
+           (int)sources.size(), net.n, seconds);
+    printf("%-6s %-44s %16s %11s\n", "rank", "station", "routes through", "share");
+    for(int i = 0; i < top && i < (int)stations.size(); ++i)
+    {
+        string name(m.stationFromId[stations[i].second]);
+        printf("%-6d %-44s %16.1f %11.6f\n", i + 1, name.c_str(), stations[i].first, stations[i].first / pairs);
+    }
+    printf("\n%-6s %-44s %16s %11s\n", "rank", "segment", "routes through", "share");
+    for(int i = 0; i < top && i < (int)segments.size(); ++i)
+    {
+        string name = string(m.stationFromId[segments[i].second.first]) + " - " + string(m.stationFromId[segments[i].second.second]);
+        printf("%-6d %-44s %16.1f %11.6f\n", i + 1, name.c_str(), segments[i].first, segments[i].first / pairs);
+    }
+}
+
+// Times findRoute one query at a time, without the cache, for each way a route can be answered.
+void runBenchmark(int queries, uint64_t seed)
+{
+    auto started = chrono::steady_clock::now();
+    const Graph &net = l.graph();
+    double graphTime = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    started = chrono::steady_clock::now();
+    const LineGraph &states = l.lineGraph();
+    double lineTime = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    const RouteTable *table = l.useTable() ? &l.table : NULL;
+    const HubLabels *hubs = l.useHubs() ? &l.hubs : NULL;
+    const Hierarchy *ch = l.useHierarchy() ? &l.ch : NULL;
+    const GeoBound &geo = l.bound();
+
+    printf("network     %d stations, %d arcs, %d line states\n", net.n, (int)net.target.size(), states.g.n);
+    printf("build       graph %.1f ms, line graph %.1f ms\n", graphTime * 1000, lineTime * 1000);
+    if(net.n < 2)
+        return;
+
+    vector<pair<int, int>> pairs(max(1, queries));
+    uint64_t state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    for(pair<int, int> &q : pairs)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        q.first = state % net.n;
+        q.second = (state >> 32) % net.n;
+    }
+
+    printf("%-30s %9s %11s %9s %9s %9s %9s %10s\n", "mode", "found", "settled", "p50 us", "p90 us", "p99 us", "max us", "queries/s");
+    for(int mode = 0; mode < 14; ++mode)
+    {
+        bool byCost = mode % 2 == 0;
+        bool lineAware = mode >= 4 && mode < 8;
+        bool guided = mode % 4 >= 2 && mode < 8;
+        const RouteTable *useTable = mode / 2 == 4 ? table : NULL;
+        const HubLabels *useHubs = mode / 2 == 5 ? hubs : NULL;
+        const Hierarchy *useCh = mode / 2 == 6 ? ch : NULL;
+        if(mode >= 8 && !useTable && !useHubs && !useCh)
+            continue;
+
+        RouteWorker w;
+        RouteResult r;
+        vector<double> micros;
+        micros.reserve(pairs.size());
+        int found = 0;
+        auto begin = chrono::steady_clock::now();
+        for(const pair<int, int> &q : pairs)
+        {
+            auto t0 = chrono::steady_clock::now();
+            found += findRoute(net, states, useTable, useHubs, useCh, guided ? &geo : NULL, w, q.first, q.second, byCost, lineAware, r);
+            micros.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count());
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+        long long settled = w.work().settled;
+        sort(micros.begin(), micros.end());
+        auto percentile = [&micros](double p) { return micros[min(micros.size() - 1, (size_t)(p * micros.size()))]; };
+        string name = useCh ? "hierarchy" : useHubs ? "hub labels" : useTable ? "route table" : lineAware ? "line-aware" : "plain";
+        if(guided)
+            name += !byCost && geo.usable ? " a*" : " bidirectional";
+        name += byCost ? " cost" : " distance";
+        printf("%-30s %9d %11.1f %9.1f %9.1f %9.1f %9.1f %10.0f\n", name.c_str(), found, (double)settled / pairs.size(),
+               percentile(0.50), percentile(0.90), percentile(0.99), micros.back(), pairs.size() / seconds);
+    }
+}
+
+#ifndef _WIN32
+volatile sig_atomic_t stopServer = 0;
+
+void onStopSignal(int)
+{
+    stopServer = 1;
+}
+
+bool sendAll(int fd, const string &text)
+{
+    size_t sent = 0;
+    while(sent < text.size())
+    {
+        ssize_t k = send(fd, text.data() + sent, text.size() - sent, 0);
+        if(k < 0 && errno == EINTR) continue;
+        if(k <= 0) return false;
+        sent += k;
+    }
+    return true;
+}
+
+// One poll thread watches idle connections; a readable connection is handed to a worker, which answers every
+// complete line it has received and then gives the connection back.
+class RouteServer
+{
+    class Connection
+    {
+    public:
+        int fd;
+        string pending;
+    };
+
+    string path;
+    int listener;
+    int wake[2];
+    mutex lock;
+    condition_variable ready;
+    deque<Connection*> work;
+    vector<Connection*> returned;
+    bool stopping;
+
+    void giveBack(Connection *c)
+    {
+        {
+            lock_guard<mutex> hold(lock);
+            returned.push_back(c);
+        }
+        char b = 0;
+        while(write(wake[1], &b, 1) < 0 && errno == EINTR) { }
+    }
+
+    // Each query pins the version current when it starts, so an edit published meanwhile never changes it mid-search.
+    void serve(bool lineAware, bool guided)
+    {
+        int slot = versions.join();
+        if(slot < 0)
+        {
+            cerr << "No free epoch slot; a route worker is not started" << endl;
+            return;
+        }
+        RouteWorker w;
+        string row, reply;
+        char buf[65536];
+        for(;;)
+        {
+            Connection *c;
+            {
+                unique_lock<mutex> hold(lock);
+                ready.wait(hold, [this] { return stopping || !work.empty(); });
+                if(work.empty()) return;
+                c = work.front();
+                work.pop_front();
+            }
+
+            ssize_t k = recv(c->fd, buf, sizeof(buf), MSG_DONTWAIT);
+            if(k < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            {
+                giveBack(c);
+                continue;
+            }
+
+            bool alive = k > 0;
+            if(alive)
+                c->pending.append(buf, k);
+
+            reply.clear();
+            size_t start = 0, end;
+            while((end = c->pending.find('\n', start)) != string::npos)
+            {
+                string q = c->pending.substr(start, end - start);
+                start = end + 1;
+                if(!q.empty() && q.back() == '\r') q.pop_back();
+                if(q.empty() || q[0] == '#') continue;
+                if(q == "quit")
+                {
+                    alive = false;
+                    break;
+                }
+                if(q == "stats")
+                {
+                    ostringstream out;
+                    metrics.write(out);
+                    row = out.str();
+                }
+                else if(q.compare(0, 8, "station ") == 0 || q.compare(0, 8, "segment ") == 0 || q.compare(0, 8, "reprice ") == 0 ||
+                        q.compare(0, 6, "close ") == 0 || q.compare(0, 7, "reopen ") == 0)
+                {
+                    if(allowEdits)
+                        applyEdit(q, row);
+                    else
+                        row = "edit,,disabled";
+                }
+                else
+                {
+                    const NetworkVersion *v = versions.pin(slot);
+                    answerQuery(q, *v, w, lineAware, guided, row);
+                    versions.unpin(slot);
+                }
+                reply += row;
+                reply += '\n';
+            }
+            c->pending.erase(0, start);
+
+            auto sending = chrono::steady_clock::now();
+            if(!reply.empty() && !sendAll(c->fd, reply))
+                alive = false;
+            else if(!reply.empty() && metrics.enabled)
+                metrics.time(QueryMetrics::REPLY, sending);
+            if(alive && c->pending.size() < (1 << 20))
+            {
+                giveBack(c);
+                continue;
+            }
+            ::close(c->fd);
+            delete c;
+        }
+    }
+
+public:
+    bool allowEdits;
+
+    RouteServer()
+    {
+        allowEdits = false;
+        listener = -1;
+        wake[0] = wake[1] = -1;
+        stopping = false;
+    }
+
+    ~RouteServer()
+    {
+        if(listener >= 0)
+        {
+            ::close(listener);
+            unlink(path.c_str());
+        }
+        if(wake[0] >= 0) ::close(wake[0]);
+        if(wake[1] >= 0) ::close(wake[1]);
+    }
+
+    bool open(const string &socketPath)
+    {
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if(socketPath.size() >= sizeof(addr.sun_path))
+            return false;
+        strcpy(addr.sun_path, socketPath.c_str());
+
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(listener < 0)
+            return false;
+        unlink(socketPath.c_str());
+        if(bind(listener, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listener, 128) < 0 || pipe(wake) < 0 ||
+           fcntl(wake[0], F_SETFL, O_NONBLOCK) < 0 || fcntl(wake[1], F_SETFL, O_NONBLOCK) < 0)
+        {
+            ::close(listener);
+            listener = -1;
+            return false;
+        }
+        path = socketPath;
+        return true;
+    }
+
+    void run(int threads)
+    {
+        {
+            lock_guard<mutex> hold(versions.writer);
+            versions.publish(l.snapshot());
+        }
+        bool lineAware = l.lineAware;
+        bool guided = l.guided;
+
+        if(threads <= 0)
+            threads = max(1u, thread::hardware_concurrency());
+        threads = min(threads, EpochDomain::SLOTS);
+        vector<thread> workers;
+        for(int i = 0; i < threads; ++i)
+        {
+            workers.push_back(thread([&] { serve(lineAware, guided); }));
+        }
+
+        signal(SIGPIPE, SIG_IGN);
+        signal(SIGINT, onStopSignal);
+        signal(SIGTERM, onStopSignal);
+
+        vector<Connection*> idle;
+        vector<pollfd> fds;
+        while(!stopServer)
+        {
+            fds.assign(2, pollfd());
+            fds[0].fd = listener;
+            fds[0].events = POLLIN;
+            fds[1].fd = wake[0];
+            fds[1].events = POLLIN;
+            for(Connection *c : idle)
+            {
+                pollfd p;
+                p.fd = c->fd;
+                p.events = POLLIN;
+                p.revents = 0;
+                fds.push_back(p);
+            }
+
+            if(poll(fds.data(), fds.size(), 500) <= 0)
+                continue;
+
+            vector<Connection*> still, readable;
+            for(size_t i = 0; i < idle.size(); ++i)
+            {
+                if(fds[i + 2].revents)
+                    readable.push_back(idle[i]);
+                else
+                    still.push_back(idle[i]);
+            }
+            idle.swap(still);
+
+            if(fds[0].revents & POLLIN)
+            {
+                int fd = accept(listener, NULL, NULL);
+                if(fd >= 0)
+                {
+                    Connection *c = new Connection;
+                    c->fd = fd;
+                    idle.push_back(c);
+                }
+            }
+            if(fds[1].revents & POLLIN)
+            {
+                char buf[256];
+                while(read(wake[0], buf, sizeof(buf)) > 0) { }
+            }
+
+            lock_guard<mutex> hold(lock);
+            idle.insert(idle.end(), returned.begin(), returned.end());
+            returned.clear();
+            if(!readable.empty())
+            {
+                work.insert(work.end(), readable.begin(), readable.end());
+                ready.notify_all();
+            }
+        }
+
+        {
+            lock_guard<mutex> hold(lock);
+            stopping = true;
+        }
+        ready.notify_all();
+        for(thread &t : workers)
+        {
+            t.join();
+        }
+        for(Connection *c : idle)
+        {
+            ::close(c->fd);
+            delete c;
+        }
+        for(Connection *c : returned)
+        {
+            ::close(c->fd);
+            delete c;
+        }
+        for(Connection *c : work)
+        {
+            ::close(c->fd);
+            delete c;
+        }
+    }
+};
+
+int connectTo(const string &socketPath)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(socketPath.size() >= sizeof(addr.sun_path))
+        return -1;
+    strcpy(addr.sun_path, socketPath.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd >= 0 && connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Each client keeps one query in flight on its own connection and times the round trip.
+int loadTest(const string &socketPath, int clients, long long requests)
+{
+    signal(SIGPIPE, SIG_IGN);
+    clients = max(1, clients);
+    int n = stationIdUsed + 1;
+    if(n <= 0)
+        return 1;
+
+    vector<vector<long long>> latencies(clients);
+    vector<long long> failures(clients, 0);
+    atomic<int> refused(0);
+    auto started = chrono::steady_clock::now();
+
+    vector<thread> threads;
+    for(int c = 0; c < clients; ++c)
+    {
+        threads.push_back(thread([&, c]
+        {
+            int fd = connectTo(socketPath);
+            if(fd < 0)
+            {
+                ++refused;
+                return;
+            }
+
+            uint64_t seed = 0x9E3779B97F4A7C15ULL * (c + 1);
+            long long count = requests / clients + (c < requests % clients ? 1 : 0);
+            latencies[c].reserve(count);
+            string pending;
+            char buf[4096];
+            static const char *criteria[] = {"cost,line", "distance,line", "cost,plain", "distance,plain"};
+            for(long long i = 0; i < count; ++i)
+            {
+                seed ^= seed << 13;
+                seed ^= seed >> 7;
+                seed ^= seed << 17;
+                int from = seed % n;
+                int to = (seed >> 20) % n;
+                string q = string(m.stationFromId[from]) + "," + string(m.stationFromId[to]) + "," + criteria[(seed >> 40) & 3] + "\n";
+
+                auto sent = chrono::steady_clock::now();
+                if(!sendAll(fd, q))
+                {
+                    failures[c] += count - i;
+                    break;
+                }
+
+                size_t end;
+                bool closed = false;
+                while((end = pending.find('\n')) == string::npos)
+                {
+                    ssize_t k = recv(fd, buf, sizeof(buf), 0);
+                    if(k < 0 && errno == EINTR) continue;
+                    if(k <= 0)
+                    {
+                        closed = true;
+                        break;
+                    }
+                    pending.append(buf, k);
+                }
+                if(closed)
+                {
+                    failures[c] += count - i;
+                    break;
+                }
+
+                latencies[c].push_back(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - sent).count());
+                string reply = pending.substr(0, end);
+                pending.erase(0, end + 1);
+                size_t status = reply.rfind(',');
+                if(status == string::npos || (reply.compare(status, string::npos, ",ok") != 0 && reply.compare(status, string::npos, ",no route") != 0))
+                    ++failures[c];
+            }
+            ::close(fd);
+        }));
+    }
+    for(thread &t : threads)
+    {
+        t.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+    vector<long long> all;
+    long long failed = 0;
+    for(int c = 0; c < clients; ++c)
+    {
+        all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+        failed += failures[c];
+    }
+    if(refused)
+        cerr << refused << " of " << clients << " clients could not connect to " << socketPath << endl;
+    if(all.empty())
+        return 1;
+
+    sort(all.begin(), all.end());
+    auto percentile = [&all](double p) { return all[min(all.size() - 1, (size_t)(p * all.size()))] / 1000.0; };
+    printf("requests    %lld (%lld failed) over %d clients\n", (long long)all.size(), failed, clients);
+    printf("elapsed     %.3f s\n", seconds);
+    printf("throughput  %.0f queries/s\n", all.size() / seconds);
+    printf("latency us  p50 %.1f  p99 %.1f  max %.1f\n", percentile(0.50), percentile(0.99), all.back() / 1000.0);
+    return failed || refused ? 1 : 0;
+}
+#endif
+
+string routeTablePath = "dmrc_routes.bin";
+string hubsPath = "dmrc_hubs.bin";
+string hierarchyPath = "dmrc_hierarchy.bin";
+string timetablePath = "dmrc_timetable.txt";
+string journalPath = "dmrc_journal.log";
+string networkPath;
+vector<string> mergePaths;
+
+bool loadBaseNetwork()
+{
+    if(networkPath.empty())
+    {
+        istringstream in(delhiNetwork);
+        return loadNetworkText(in, "built-in network");
+    }
+    if(loadNetworkSnapshot(networkPath))
+        return true;
+    networkSnapshot.close();
+
+    ifstream in(networkPath);
+    if(!in)
+    {
+        cerr << "Could not open " << networkPath << endl;
+        return false;
+    }
+    return loadNetworkText(in, networkPath);
+}
+
+// Each --merge file adds its stations and segments to the base network; a station name already known is the same
+// station, so systems that meet there become one graph with an interchange.
+bool loadNetwork()
+{
+    if(!loadBaseNetwork())
+        return false;
+    for(const string &path : mergePaths)
+    {
+        ifstream in(path);
+        if(!in)
+        {
+            cerr << "Could not open " << path << endl;
+            return false;
+        }
+        if(!loadNetworkText(in, path))
+            return false;
+    }
+    return true;
+}
+
+// Names the network the journal's edits were made to by the contents of its base and merged files in order, so
+// editing or replacing one of them stops old edits being replayed onto a different network.
+uint64_t networkOrigin()
+{
+    uint64_t h = 1469598103934665603ULL;
+    auto mix = [&h](const char *p, size_t len)
+    {
+        for(size_t i = 0; i < len; ++i)
+        {
+            h ^= (unsigned char)p[i];
+            h *= 1099511628211ULL;
+        }
+    };
+
+    vector<string> paths(1, networkPath);
+    paths.insert(paths.end(), mergePaths.begin(), mergePaths.end());
+    vector<char> buf(1 << 16);
+    for(const string &path : paths)
+    {
+        uint64_t length = 0;
+        if(path.empty())
+        {
+            length = strlen(delhiNetwork);
+            mix(delhiNetwork, length);
+        }
+        else
+        {
+            ifstream in(path, ios::binary);
+            while(in.read(buf.data(), buf.size()) || in.gcount() > 0)
+            {
+                mix(buf.data(), in.gcount());
+                length += in.gcount();
+            }
+        }
+        mix((const char*)&length, sizeof(length));
+    }
+    return h;
+}
+
+// A compacted journal starts from its own base snapshot, which already holds the network and earlier edits.
+void getReady()
 {
+    if(!journal.open(journalPath, networkOrigin()))
+        cerr << "Journal " << journalPath << " was written for another network; edits will not be saved" << endl;
+    if(journal.generation > 0)
+    {
+        if(!loadNetworkSnapshot(journal.basePath(journal.generation)))
+        {
+            cerr << "Could not load " << journal.basePath(journal.generation) << endl;
+            exit(1);
+        }
+    }
+    else if(!loadNetwork())
+        exit(1);
+    journal.replay();
+    l.table.load(routeTablePath);
+    l.hubs.load(hubsPath);
+    l.loadHierarchy(hierarchyPath);
+    l.loadTimetable(timetablePath);
+}
+
+int main(int argc, char *argv[])
+{
+    string batchInput;
+    bool batch = false;
+    int threads = 0;
+    string servePath, loadPath;
+    bool allowEdits = false;
+    int clients = 8;
+    long long requests = 100000;
+    bool benchmark = false;
+    string demandPath;
+    int routes = 1;
+    bool assignByCost = true;
+    int isochroneKind = -1;
+    double isochroneBudget = 0;
+    string isochronePath;
+    int queries = 10000;
+    uint64_t seed = 1;
+    int betweenness = -1;
+    string closurePath;
+    string statsPath;
+    int samples = 0;
+    int top = 20;
+    string action, actionPath;
+    long long generateStations = 0;
+
+    auto usage = [argv]()
+    {
+        cerr << "Usage: " << argv[0] << " [--network FILE] [--merge FILE]... [--journal FILE] [--tables FILE] [--hubs FILE] [--hierarchy FILE] [--timetable FILE] [--stats FILE]" << endl;
+        cerr << "       " << argv[0] << " [--network FILE] --build-tables [FILE] | --build-hubs [FILE] | --build-hierarchy [FILE] | --compile-network FILE | --compact-journal" << endl;
+        cerr << "       " << argv[0] << " --batch [FILE] [--threads N] [--plain|--line-aware] [--guided] [--cache ROUTES] [--stats FILE]" << endl;
+        cerr << "       " << argv[0] << " --serve SOCKET [--threads N] [--plain|--line-aware] [--guided] [--cache ROUTES] [--allow-edits] [--stats FILE]" << endl;
+        cerr << "       " << argv[0] << " --load-test SOCKET [--clients N] [--requests N]" << endl;
+        cerr << "       " << argv[0] << " [--seed S] --generate-network STATIONS FILE" << endl;
+        cerr << "       " << argv[0] << " [--network FILE] --benchmark [--queries N] [--seed S] [--stats FILE]" << endl;
+        cerr << "       " << argv[0] << " [--network FILE] --assign DEMAND [--routes K] [--by cost|distance] [--threads N]" << endl;
+        cerr << "       " << argv[0] << " [--network FILE] --isochrones fare|distance|interchanges BUDGET FILE [--threads N]" << endl;
+        cerr << "       " << argv[0] << " [--network FILE] --disruption CLOSURES [--by cost|distance] [--threads N]" << endl;
+        cerr << "       " << argv[0] << " [--network FILE] --betweenness cost|distance [--samples N] [--seed S] [--top N] [--threads N]" << endl;
+        return 1;
+    };
+
+    for(int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if(arg == "--tables" && i + 1 < argc)
+        {
+            routeTablePath = argv[++i];
+        }
+        else if(arg == "--build-tables")
+        {
+            action = arg;
+            if(i + 1 < argc && argv[i + 1][0] != '-')
+                routeTablePath = argv[++i];
+        }
+        else if(arg == "--hubs" && i + 1 < argc)
+        {
+            hubsPath = argv[++i];
+        }
+        else if(arg == "--build-hubs")
+        {
+            action = arg;
+            if(i + 1 < argc && argv[i + 1][0] != '-')
+                hubsPath = argv[++i];
+        }
+        else if(arg == "--hierarchy" && i + 1 < argc)
+        {
+            hierarchyPath = argv[++i];
+        }
+        else if(arg == "--build-hierarchy")
+        {
+            action = arg;
+            if(i + 1 < argc && argv[i + 1][0] != '-')
+                hierarchyPath = argv[++i];
+        }
+        else if(arg == "--journal" && i + 1 < argc)
+        {
+            journalPath = argv[++i];
+        }
+        else if(arg == "--compact-journal")
+        {
+            action = arg;
+        }
+        else if(arg == "--merge" && i + 1 < argc)
+        {
+            mergePaths.push_back(argv[++i]);
+        }
+        else if(arg == "--batch")
+        {
+            batch = true;
+            if(i + 1 < argc && argv[i + 1][0] != '-')
+                batchInput = argv[++i];
+        }
+        else if(arg == "--network" && i + 1 < argc)
+        {
+            networkPath = argv[++i];
+        }
+        else if(arg == "--compile-network" && i + 1 < argc)
+        {
+            action = arg;
+            actionPath = argv[++i];
+        }
+        else if(arg == "--timetable" && i + 1 < argc)
+        {
+            timetablePath = argv[++i];
+        }
+        else if(arg == "--cache" && i + 1 < argc)
+        {
+            l.cache.setCapacity(max(0, atoi(argv[++i])));
+        }
+        else if(arg == "--threads" && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if(arg == "--plain")
+        {
+            l.lineAware = false;
+        }
+        else if(arg == "--line-aware")
+        {
+            l.lineAware = true;
+        }
+        else if(arg == "--guided")
+        {
+            l.guided = true;
+        }
+        else if(arg == "--serve" && i + 1 < argc)
+        {
+            servePath = argv[++i];
+        }
+        else if(arg == "--allow-edits")
+        {
+            allowEdits = true;
+        }
+        else if(arg == "--load-test" && i + 1 < argc)
+        {
+            loadPath = argv[++i];
+        }
+        else if(arg == "--clients" && i + 1 < argc)
+        {
+            clients = atoi(argv[++i]);
+        }
+        else if(arg == "--requests" && i + 1 < argc)
+        {
+            requests = max(1LL, atoll(argv[++i]));
+        }
+        else if(arg == "--seed" && i + 1 < argc)
+        {
+            seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if(arg == "--generate-network" && i + 2 < argc)
+        {
+            action = arg;
+            generateStations = atoll(argv[++i]);
+            actionPath = argv[++i];
+        }
+        else if(arg == "--assign" && i + 1 < argc)
+        {
+            demandPath = argv[++i];
+        }
+        else if(arg == "--routes" && i + 1 < argc)
+        {
+            routes = max(1, atoi(argv[++i]));
+        }
+        else if(arg == "--by" && i + 1 < argc)
+        {
+            string by = argv[++i];
+            if(by != "cost" && by != "distance")
+            {
+                cerr << "--by must be cost or distance" << endl;
+                return usage();
+            }
+            assignByCost = by == "cost";
+        }
+        else if(arg == "--benchmark")
+        {
+            benchmark = true;
+        }
+        else if(arg == "--stats" && i + 1 < argc)
+        {
+            statsPath = argv[++i];
+        }
+        else if(arg == "--isochrones" && i + 3 < argc)
+        {
+            string kind = argv[++i];
+            double budget = atof(argv[++i]);
+            string out = argv[++i];
+            int k = kind == "fare" ? Isochrone::FARE : kind == "distance" ? Isochrone::DISTANCE : kind == "interchanges" ? Isochrone::INTERCHANGES : -1;
+            if(k < 0 || budget < 0)
+            {
+                cerr << "Budget must be fare, distance or interchanges with a non-negative limit" << endl;
+                return 1;
+            }
+            isochroneKind = k;
+            isochroneBudget = budget;
+            isochronePath = out;
+        }
+        else if(arg == "--betweenness" && i + 1 < argc)
+        {
+            string by = argv[++i];
+            if(by != "cost" && by != "distance")
+            {
+                cerr << "--betweenness must be cost or distance" << endl;
+                return usage();
+            }
+            betweenness = by == "distance" ? 0 : 1;
+        }
+        else if(arg == "--disruption" && i + 1 < argc)
+        {
+            closurePath = argv[++i];
+        }
+        else if(arg == "--samples" && i + 1 < argc)
+        {
+            samples = max(0, atoi(argv[++i]));
+        }
+        else if(arg == "--top" && i + 1 < argc)
+        {
+            top = max(1, atoi(argv[++i]));
+        }
+        else if(arg == "--queries" && i + 1 < argc)
+        {
+            queries = max(1, atoi(argv[++i]));
+        }
+        else
+        {
+            return usage();
+        }
+    }
+
+    // One-off actions run only now, so options given after them on the command line still apply.
+    if(action == "--generate-network")
+    {
+        ofstream file(actionPath);
+        if(!file || !generateNetwork(generateStations, seed, file))
+        {
+            cerr << "Could not generate a network of " << generateStations << " stations into " << actionPath << endl;
+            return 1;
+        }
+        cout << "Network of " << generateStations << " stations written to " << actionPath << endl;
+        return 0;
+    }
+
     getReady();
+
+    if(action == "--build-tables")
+    {
+        if(!RouteTable::build(l.graph(), l.fingerprint(), routeTablePath))
+        {
+            cerr << "Could not write route tables to " << routeTablePath << endl;
+            return 1;
+        }
+        cout << "Route tables for " << l.graph().n << " stations written to " << routeTablePath << endl;
+        return 0;
+    }
+    if(action == "--build-hubs")
+    {
+        if(!HubLabels::build(l.graph(), l.fingerprint(), hubsPath) || !l.hubs.load(hubsPath))
+        {
+            cerr << "Could not write hub labels to " << hubsPath << endl;
+            return 1;
+        }
+        cout << "Hub labels for " << l.hubs.n << " stations written to " << hubsPath << ": " <<
+                l.hubs.cost.offset[l.hubs.n] << " by cost, " << l.hubs.dist.offset[l.hubs.n] << " by distance" << endl;
+        return 0;
+    }
+    if(action == "--build-hierarchy")
+    {
+        auto started = chrono::steady_clock::now();
+        l.ch.build(l.graph());
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        if(!l.ch.save(hierarchyPath))
+        {
+            cerr << "Could not write the hierarchy to " << hierarchyPath << endl;
+            return 1;
+        }
+        cout << "Hierarchy for " << l.ch.n << " stations with " << l.ch.target.size() << " upward arcs written to " <<
+                hierarchyPath << " in " << seconds << " s" << endl;
+        return 0;
+    }
+    if(action == "--compact-journal")
+    {
+        if(!journal.compact())
+        {
+            cerr << "Could not compact " << journalPath << endl;
+            return 1;
+        }
+        cout << "Journal " << journalPath << " compacted into " << journal.basePath(journal.generation) << endl;
+        return 0;
+    }
+    if(action == "--compile-network")
+    {
+        if(!writeNetworkSnapshot(actionPath))
+        {
+            cerr << "Could not write network snapshot to " << actionPath << endl;
+            return 1;
+        }
+        cout << "Network of " << stationIdUsed + 1 << " stations compiled to " << actionPath << endl;
+        return 0;
+    }
+
+    metrics.enabled = !statsPath.empty() || !servePath.empty();
+
+    if(benchmark)
+    {
+        runBenchmark(queries, seed);
+        return statsPath.empty() || writeMetrics(statsPath) ? 0 : 1;
+    }
+
+    if(!closurePath.empty())
+    {
+        ios::sync_with_stdio(false);
+        ifstream in(closurePath);
+        if(!in)
+        {
+            cerr << "Could not open " << closurePath << endl;
+            return 1;
+        }
+        if(!applyClosures(in, closurePath))
+            return 1;
+        if(assignByCost)
+        {
+            Disruption<int> report;
+            double seconds = assessClosures(report, threads);
+            writeDisruptions(report, cout, report.changes.size());
+            summariseDisruptions(report, seconds, cerr);
+        }
+        else
+        {
+            Disruption<double> report;
+            double seconds = assessClosures(report, threads);
+            writeDisruptions(report, cout, report.changes.size());
+            summariseDisruptions(report, seconds, cerr);
+        }
+        return 0;
+    }
+
+    if(betweenness >= 0)
+    {
+        if(betweenness)
+            runBetweenness<int>(samples, top, threads, seed);
+        else
+            runBetweenness<double>(samples, top, threads, seed);
+        return 0;
+    }
+
+    if(!demandPath.empty())
+    {
+        ios::sync_with_stdio(false);
+        ifstream in(demandPath);
+        if(!in)
+        {
+            cerr << "Could not open " << demandPath << endl;
+            return 1;
+        }
+        return runAssignment(in, cout, routes, assignByCost, threads) ? 0 : 1;
+    }
+
+    if(isochroneKind >= 0)
+    {
+        auto started = chrono::steady_clock::now();
+        if(!writeIsochrones(isochronePath, isochroneKind, isochroneBudget, threads))
+        {
+            cerr << "Could not write isochrones to " << isochronePath << endl;
+            return 1;
+        }
+        cout << "Isochrones for " << l.graph().n << " stations written to " << isochronePath << " in ";
+        cout << chrono::duration<double>(chrono::steady_clock::now() - started).count() << " s" << endl;
+        return 0;
+    }
+
+    if(!servePath.empty() || !loadPath.empty())
+    {
+#ifdef _WIN32
+        cerr << "The route daemon needs Unix domain sockets and is not available on this platform" << endl;
+        return 1;
+#else
+        if(!loadPath.empty())
+            return loadTest(loadPath, clients, requests);
+
+        RouteServer server;
+        server.allowEdits = allowEdits;
+        if(!server.open(servePath))
+        {
+            cerr << "Could not listen on " << servePath << endl;
+            return 1;
+        }
+        cerr << "Serving " << stationIdUsed + 1 << " stations on " << servePath << endl;
+        server.run(threads);
+        return statsPath.empty() || writeMetrics(statsPath) ? 0 : 1;
+#endif
+    }
+
+    if(batch)
+    {
+        ios::sync_with_stdio(false);
+        if(batchInput.empty() || batchInput == "-")
+            runBatch(cin, cout, threads);
+        else
+        {
+            ifstream in(batchInput);
+            if(!in)
+            {
+                cerr << "Could not open " << batchInput << endl;
+                return 1;
+            }
+            runBatch(in, cout, threads);
+        }
+        return statsPath.empty() || writeMetrics(statsPath) ? 0 : 1;
+    }
+
     home();
+    if(!statsPath.empty())
+        writeMetrics(statsPath);
     system("cls");
     cout << "========================================" << endl;
     cout << "   Thank you for using Metro System!   " << endl;
@@ -970,4 +7553,4 @@ int main()
     cout << "Press any key to exit... ";
     getch();
     return 0;
-}
\ No newline at end of file
+}